@@ -40,7 +40,7 @@ int main()
 
   auto f = pr::one_neighbour(0.5);
   double stat;
-  auto success = pr::fuzzy_kappa_2009(a, b, mask, 3, 3, m, f, result, pr::gdal_raster_maker{}, stat);
+  auto success = pr::fuzzy_kappa_2009(a, b, mask, 3, 3, m, f, result, pr::memory_raster_maker{}, stat);
   pr::plot_raster(result);
   return 0;
 }
\ No newline at end of file
@@ -11,12 +11,20 @@
 #pragma once
 
 
+#include <pronto/raster/block_layout.h>
 #include <pronto/raster/gdal_raster_view.h>
 #include <pronto/raster/uncasted_gdal_raster_view.h>
 #include <pronto/raster/optional.h>
 #include <pronto/raster/raster.h>
+#include <pronto/raster/stretch.h>
+#include <pronto/raster/tile_scheduler.h>
 
+#include <algorithm> // std::max
+#include <execution>
+#include <memory>
 #include <ranges>
+#include <span>
+#include <type_traits>
 #include <variant>
 #include <cassert>
 
@@ -37,12 +45,113 @@ namespace pronto {
       }
     }
 
+    namespace detail {
+      // Row-by-row copy, one row of the input is buffered and then written
+      // to the stretches of the output.
+      template<MutableStretchRasterConcept RasterTo, StretchRasterConcept RasterFrom>
+      void assign_stretched(RasterTo& to, const RasterFrom& from)
+      {
+        using in_value_type = std::ranges::range_value_t<RasterFrom>;
+        using out_value_type = std::ranges::range_value_t<RasterTo>;
+        auto buffer = std::make_unique<in_value_type[]>(from.cols());
+        int buffered_row = -1;
+        to.for_each_stretch([&](int row, int col, auto stretch) {
+          if (row != buffered_row) {
+            read_row(from, row, buffer.get());
+            buffered_row = row;
+          }
+          const in_value_type* source = buffer.get() + col;
+          for (std::size_t k = 0; k < stretch.size(); ++k) {
+            stretch[k] = static_cast<out_value_type>(source[k]);
+          }
+          });
+      }
+
+      template<class R>
+      constexpr bool is_gdal_backed_v = false;
+
+      template<class T, iteration_type I, access A>
+      constexpr bool is_gdal_backed_v<gdal_raster_view<T, I, A> > = true;
+
+      template<class T, iteration_type I, access A>
+      constexpr bool is_gdal_backed_v<uncasted_gdal_raster_view<T, I, A> > = true;
+
+      // When the data types of the bands correspond to the value types,
+      // RasterIO does not convert values and copying via RasterIO has the
+      // same result as copying cell-by-cell.
+      template<class Raster>
+      bool has_native_data_type(const Raster& raster)
+      {
+        using value_type = std::ranges::range_value_t<Raster>;
+        return is_native_gdal_data_type<value_type>(
+          raster.get_band()->GetRasterDataType());
+      }
+
+      // Tile-by-tile copy with one RasterIO call to read and one to write
+      // each tile. The tiles are aligned to the blocks of the output.
+      template<class RasterTo, class RasterFrom>
+      void assign_raster_io(RasterTo& to, const RasterFrom& from)
+      {
+        using in_value_type = std::ranges::range_value_t<RasterFrom>;
+        using out_value_type = std::ranges::range_value_t<RasterTo>;
+        static const bool same_type = std::is_same_v<in_value_type, out_value_type>;
+
+        const tile_grid grid = make_tile_grid(to.rows(), to.cols(), get_tile_layout(to));
+        std::size_t buffer_size = 0;
+        for (int i = 0; i < grid.size(); ++i) {
+          const tile t = grid[i];
+          buffer_size = std::max(buffer_size, static_cast<std::size_t>(t.rows) * t.cols);
+        }
+        auto in_buffer = std::make_unique<in_value_type[]>(buffer_size);
+        std::unique_ptr<out_value_type[]> out_buffer;
+        if constexpr (!same_type) {
+          out_buffer = std::make_unique<out_value_type[]>(buffer_size);
+        }
+
+        for (int i = 0; i < grid.size(); ++i) {
+          const tile t = grid[i];
+          const std::size_t n = static_cast<std::size_t>(t.rows) * t.cols;
+          auto sub_from = from.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+          auto sub_to = to.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+          sub_from.read_into(std::span<in_value_type>(in_buffer.get(), n));
+          if constexpr (same_type) {
+            sub_to.write_from(std::span<const out_value_type>(in_buffer.get(), n));
+          }
+          else {
+            for (std::size_t k = 0; k < n; ++k) {
+              out_buffer[k] = static_cast<out_value_type>(in_buffer[k]);
+            }
+            sub_to.write_from(std::span<const out_value_type>(out_buffer.get(), n));
+          }
+        }
+      }
+    } // detail
+
     template<RasterConcept RasterTo, RasterConcept RasterFrom> // only really needs to be a range
     void assign(RasterTo& to, const RasterFrom& from)
     {
       using in_value_type = std::ranges::range_value_t<RasterFrom>;
       using out_value_type = std::ranges::range_value_t<RasterTo>;
       using inner_out_value_type = recursive_optional_value_type<out_value_type>;
+
+      if constexpr (detail::is_gdal_backed_v<RasterTo> 
+        && detail::is_gdal_backed_v<RasterFrom>
+        && MutableStretchRasterConcept<RasterTo>
+        && is_raster_io_type_v<in_value_type> && is_raster_io_type_v<out_value_type>)
+      {
+        if (detail::has_native_data_type(to) && detail::has_native_data_type(from)) {
+          detail::assign_raster_io(to, from);
+          return;
+        }
+      }
+
+      if constexpr (MutableStretchRasterConcept<RasterTo> 
+        && StretchRasterConcept<RasterFrom>
+        && !is_optional_v<in_value_type> && !is_optional_v<out_value_type>)
+      {
+        detail::assign_stretched(to, from);
+        return;
+      }
       
       auto i = from.begin();
       auto i_end = from.end();
@@ -102,47 +211,104 @@ namespace pronto {
       std::visit([](auto a, auto b) { assign(a, b); }, to, from);
     }
     template<class RasterViewOut, class RasterViewIn>
-    void assign_blocked(RasterViewOut& out, const RasterViewIn& in, int block_row_size, int block_col_size)
+    void assign_blocked(RasterViewOut& out, const RasterViewIn& in, int block_row_size, int block_col_size
+      , int row_offset = 0, int col_offset = 0)
     {
       assert(out.rows() == in.rows() && out.cols() == in.cols());
-      const int blocks_per_row = (in.rows() + block_row_size - 1) / block_row_size;
-      const int blocks_per_col = (in.cols() + block_row_size - 1) / block_col_size;
-      int nblocks = blocks_per_row * blocks_per_col;
-
-      for (int block_row = 0; block_row < blocks_per_row; ++block_row) {
-        for (int block_col = 0; block_col < blocks_per_col; ++block_col) {
-
-          //auto do_block = [&, block_row, block_col]()
-          //{
-          const int first_row = block_row * block_row_size;
-          const int first_col = block_col * block_col_size;
-          const int rows = std::min<int>(in.rows() - first_row, block_row_size);
-          const int cols = std::min<int>(in.cols() - first_col, block_col_size);
-          auto sub_out = out.sub_raster(first_row, first_col, rows, cols);
-          auto sub_in = in.sub_raster(first_row, first_col, rows, cols);
-
-          assign(sub_out, sub_in);
-          // };
-          // do_block(); // prepared for parallelization
-        }
+      const tile_grid grid(in.rows(), in.cols(), block_row_size, block_col_size
+        , row_offset, col_offset);
+
+      for (int i = 0; i < grid.size(); ++i) {
+        const tile t = grid[i];
+        auto sub_out = out.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+        auto sub_in = in.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+        assign(sub_out, sub_in);
       }
     }
 
+    // The tiles are distributed over num_threads threads. Each tile is 
+    // written by a single thread, so when tiles are aligned to the blocks of
+    // the output, each block of the output is written by one thread only.
+    // Reading from in must be safe from multiple threads.
+    template<class RasterViewOut, class RasterViewIn>
+    void assign_blocked_parallel(RasterViewOut& out, const RasterViewIn& in
+      , int block_row_size, int block_col_size
+      , int row_offset = 0, int col_offset = 0
+      , int num_threads = default_number_of_threads())
+    {
+      assert(out.rows() == in.rows() && out.cols() == in.cols());
+      const tile_grid grid(in.rows(), in.cols(), block_row_size, block_col_size
+        , row_offset, col_offset);
+
+      parallel_for_each_tile(grid, [&](const tile& t, int) {
+        auto sub_out = out.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+        auto sub_in = in.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+        assign(sub_out, sub_in);
+        }, num_threads);
+    }
+
     // Exploiting that we can get the block size of gdal_raster_views.
     template<class T, iteration_type IType, access AType, class RasterViewIn>
     void assign_blocked(gdal_raster_view<T, IType, AType>& out, const RasterViewIn& in)
     {
-      int block_row_size, block_col_size;
-      out.get_band()->GetBlockSize(&block_col_size, &block_row_size);
-      assign_blocked(out, in, block_row_size, block_col_size);
+      const block_layout layout = get_tile_layout(out);
+      assign_blocked(out, in, layout.rows, layout.cols, layout.row_offset
+        , layout.col_offset);
     }
     // Exploiting that we can get the block size of gdal_raster_views.
     template<class T, iteration_type IType, access AType, class RasterViewIn>
     void assign_blocked(uncasted_gdal_raster_view<T, IType, AType>& out, const RasterViewIn& in)
     {
-      int block_row_size, block_col_size;
-      out.get_band()->GetBlockSize(&block_col_size, &block_row_size);
-      assign_blocked(out, in, block_row_size, block_col_size);
+      const block_layout layout = get_tile_layout(out);
+      assign_blocked(out, in, layout.rows, layout.cols, layout.row_offset
+        , layout.col_offset);
+    }
+
+    template<class RasterViewOut, class RasterViewIn>
+    void assign_blocked_parallel(RasterViewOut& out, const RasterViewIn& in
+      , int num_threads = default_number_of_threads())
+    {
+      const block_layout layout = get_tile_layout(out);
+      assign_blocked_parallel(out, in, layout.rows, layout.cols
+        , layout.row_offset, layout.col_offset, num_threads);
+    }
+
+    // The order in which cells are visited by assign
+    enum class traversal
+    {
+      row_major,
+      tile_major
+    };
+
+    // In tile-major order the raster is assigned one tile at a time. The 
+    // tiles are aligned to the blocks of the inputs, or of the output when
+    // none of the inputs is backed by blocks. This way each block is read
+    // once, instead of once per row.
+    template<RasterConcept RasterTo, RasterConcept RasterFrom>
+    void assign(RasterTo& to, const RasterFrom& from, traversal order)
+    {
+      if (order == traversal::row_major) {
+        assign(to, from);
+        return;
+      }
+      const block_layout layout = get_tile_layout(from, to);
+      assign_blocked(to, from, layout.rows, layout.cols, layout.row_offset
+        , layout.col_offset);
+    }
+
+    // Sequenced policies assign cell-by-cell, other policies assign in 
+    // tiles that are aligned to the blocks of the output on multiple threads
+    template<class ExecutionPolicy, RasterConcept RasterTo, RasterConcept RasterFrom>
+      requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy> >
+    void assign(ExecutionPolicy&&, RasterTo& to, const RasterFrom& from)
+    {
+      if constexpr (std::is_same_v<std::remove_cvref_t<ExecutionPolicy>
+        , std::execution::sequenced_policy>) {
+        assign(to, from);
+      }
+      else {
+        assign_blocked_parallel(to, from);
+      }
     }
     
   }
@@ -0,0 +1,104 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// Rasters backed by GDAL are stored in blocks. Visiting such rasters
+// row-by-row touches all blocks in a strip for each row, visiting them
+// tile-by-tile with tiles aligned to the blocks touches each block once.
+// This header gets the block layout of rasters and composite views, and
+// provides the tile-major traversal.
+//
+
+#pragma once
+
+#include <pronto/raster/gdal_raster_view.h>
+#include <pronto/raster/tile_scheduler.h>
+#include <pronto/raster/transform_raster_view.h>
+#include <pronto/raster/uncasted_gdal_raster_view.h>
+
+#include <optional>
+#include <tuple>
+
+namespace pronto
+{
+  namespace raster
+  {
+    // Blocks of rows x cols cells, the first block starts row_offset rows
+    // and col_offset columns before the first cell of the (sub-)raster.
+    struct block_layout
+    {
+      int rows;
+      int cols;
+      int row_offset;
+      int col_offset;
+    };
+
+    // Rasters that are not backed by blocks have no layout
+    template<class Raster>
+    std::optional<block_layout> get_block_layout(const Raster&)
+    {
+      return std::nullopt;
+    }
+
+    template<class T, iteration_type IType, access AType>
+    std::optional<block_layout> get_block_layout(const gdal_raster_view<T, IType, AType>& raster)
+    {
+      return block_layout{ raster.get_block_rows(), raster.get_block_cols()
+        , raster.get_first_row(), raster.get_first_col() };
+    }
+
+    template<class T, iteration_type IType, access AType>
+    std::optional<block_layout> get_block_layout(const uncasted_gdal_raster_view<T, IType, AType>& raster)
+    {
+      block_layout layout{ 0, 0, raster.get_first_row(), raster.get_first_col() };
+      raster.get_band()->GetBlockSize(&layout.cols, &layout.rows);
+      return layout;
+    }
+
+    // The layout of the first input that has one
+    template<class F, class... R>
+    std::optional<block_layout> get_block_layout(const transform_raster_view<F, R...>& raster)
+    {
+      return std::apply([](const auto&... rasters) {
+        std::optional<block_layout> layout;
+        (..., (layout = layout ? layout : get_block_layout(rasters)));
+        return layout;
+        }, raster.m_rasters);
+    }
+
+    // The layout of the first raster that has one, or tiles of 256 x 256
+    // cells if none of the rasters is backed by blocks
+    template<class... Rasters>
+    block_layout get_tile_layout(const Rasters&... rasters)
+    {
+      std::optional<block_layout> layout;
+      (..., (layout = layout ? layout : get_block_layout(rasters)));
+      return layout.value_or(block_layout{ 256, 256, 0, 0 });
+    }
+
+    inline tile_grid make_tile_grid(int rows, int cols, const block_layout& layout)
+    {
+      return tile_grid(rows, cols, layout.rows, layout.cols
+        , layout.row_offset, layout.col_offset);
+    }
+
+    // Calls f(tile, sub_raster) for each tile of the raster, the tiles are
+    // aligned to the blocks of the raster (or its inputs) and visited in
+    // row-major order.
+    template<class Raster, class F>
+    void for_each_tile(const Raster& raster, F&& f)
+    {
+      const tile_grid grid = make_tile_grid(raster.rows(), raster.cols()
+        , get_tile_layout(raster));
+      for (int i = 0; i < grid.size(); ++i) {
+        const tile t = grid[i];
+        f(t, raster.sub_raster(t.first_row, t.first_col, t.rows, t.cols));
+      }
+    }
+  }
+}
@@ -8,19 +8,23 @@
 //=======================================================================
 //
 // This implements the distance transform method by Meijster. 
-// The method is very amenable to parallelization. 
-// But not done here..
+// The method is very amenable to parallelization: the first phase is 
+// independent for each column and the second phase for each row. The 
+// parallel_distance_transform does both phases on multiple threads.
 
 // TODO: Read this https://stackoverflow.com/questions/43655668/are-all-integer-values-perfectly-represented-as-doubles
 // and make a sensible check for the type of the output raster, knowing that we also use it to store ints.
 
 #pragma once
 #include <pronto/raster/assign.h>
+#include <pronto/raster/tile_scheduler.h>
 #include <pronto/raster/traits.h>
 #include <pronto/raster/transform_raster_view.h>
 
 #include <cassert>
 #include <algorithm>
+#include <cmath> // std::sqrt
+#include <cstddef> // std::ptrdiff_t
 #include <vector>
 
  namespace pronto {
@@ -86,7 +90,7 @@
 
     namespace detail
     {
-      large_int round(const double& f)
+      inline large_int round(const double& f)
       {
         return static_cast<large_int>(f + 0.5);
       }
@@ -104,36 +108,36 @@
         return value;
       }
       */
-      large_int f(large_int x, large_int i, std::vector<large_int>& g, const euclidean&)
+      inline large_int f(large_int x, large_int i, std::vector<large_int>& g, const euclidean&)
       {
         const long long dx = x - i;
         const long long dy = g[i];
         return dx * dx + dy * dy;
       }
 
-      large_int f(large_int x, large_int i, std::vector<large_int>& g, const manhattan&)
+      inline large_int f(large_int x, large_int i, std::vector<large_int>& g, const manhattan&)
       {
         return abs(x - i) + g[i];
       }
 
-      large_int f(large_int x, large_int i, std::vector<large_int>& g, const chessboard&)
+      inline large_int f(large_int x, large_int i, std::vector<large_int>& g, const chessboard&)
       {
         return std::max(abs(x - i), g[i]);
       }
 
-      large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int, const euclidean&)
+      inline large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int, const euclidean&)
       {
         return ((u-i) * (u+i) + (g[u] - g[i]) * (g[u] + g[i] ) ) / (2 * (u - i));
       }
 
-      large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int inf, const manhattan&)
+      inline large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int inf, const manhattan&)
       {
         if (g[u] >= g[i] + u - i) return inf;
         if (g[i] > g[u] + u - i) return -inf;
         return (g[u] - g[i] + u + i) / 2;
       }
 
-      large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int, const chessboard&)
+      inline large_int sep(large_int i, large_int u, std::vector<large_int>& g, large_int, const chessboard&)
       {
         if (g[i] <= g[u]) return std::max(i + g[u], (i + u) / 2);
         return std::min(u - g[i], (i + u) / 2);
@@ -189,6 +193,38 @@
         }
         return has_target;
       }
+
+      // As process_line, but g holds the values of the row in order and out 
+      // points to the first cell of the result row.
+      template<class OutIterator, class MethodTag, class PostProcess>
+      void process_row(std::vector<large_int>& g, std::vector<st_pair>& st
+        , large_int inf, OutIterator out, const MethodTag&
+        , const PostProcess& post_processor)
+      {
+        const large_int m = static_cast<large_int>(g.size());
+        st.assign(1, st_pair(0, 0));
+        for (large_int u = 1; u < m; ++u) {
+          while (!st.empty() && f(st.back().t, st.back().s, g, MethodTag{})
+                > f(st.back().t, u, g, MethodTag{})){
+            st.pop_back();
+          }
+          if (st.empty()){
+            st.emplace_back(u, 0);
+          }
+          else {
+            const large_int w = 1 + sep(st.back().s, u, g, inf, MethodTag{});
+            if (w < m){
+              st.emplace_back(u, w);
+            }
+          }
+        }
+        for (large_int u = m - 1; u >= 0; --u) {
+          out[u] = post_processor(f(u, st.back().s, g, MethodTag{}));
+          if (u == st.back().t) {
+            st.pop_back();
+          }
+        }
+      }
     }
 
     // Return false if target is not present in raster, true otherwise
@@ -295,5 +331,100 @@
       bool has_target = detail::process_line(first_row, inf, Method{}, post_processor);
       return has_target;
     }
+
+    // As distance_transform, but the column phase runs in vertical strips
+    // and the row phase in horizontal bands on num_threads threads. The 
+    // column phase works on a contiguous buffer of ints for the raster, the
+    // row phase buffers the results of a chunk of bands. The input is read 
+    // and the output written in a single pass on the calling thread. The 
+    // post_processor is called from multiple threads.
+    // Return false if target is not present in raster, true otherwise
+    template<class InRaster, class OutRaster, class Method, class PostProcess>
+    bool parallel_distance_transform(const InRaster& in, OutRaster& out,
+      const typename traits<InRaster>::value_type& target,
+      const Method&, const PostProcess& post_processor
+      , int num_threads = default_number_of_threads())
+    {
+      using out_type = typename traits<OutRaster>::value_type;
+      const int rows = in.rows();
+      const int cols = in.cols();
+      assert(rows == out.rows());
+      assert(cols == out.cols());
+      if (rows == 0 || cols == 0) return false;
+      const int inf = rows + cols;
+
+      std::vector<int> distance;
+      distance.reserve(static_cast<std::size_t>(rows) * cols);
+      bool has_target = false;
+      for (auto&& a : in) {
+        const bool is_target = a == target;
+        has_target = has_target || is_target;
+        distance.push_back(is_target ? 0 : inf);
+      }
+      auto row = [&](int r) {
+        return distance.data() + static_cast<std::ptrdiff_t>(r) * cols;
+      };
+
+      // Distance to the nearest target in the same column, in strips of 
+      // adjacent columns that are scanned down and up
+      const int strip = 16;
+      parallel_for_each_task((cols + strip - 1) / strip, [&](int task, int) {
+        const int first_col = task * strip;
+        const int end_col = std::min(cols, first_col + strip);
+        for (int r = 1; r < rows; ++r) {
+          int* d = row(r);
+          const int* above = row(r - 1);
+          for (int c = first_col; c < end_col; ++c) {
+            if (d[c] != 0) d[c] = above[c] == inf ? inf : above[c] + 1;
+          }
+        }
+        for (int r = rows - 2; r >= 0; --r) {
+          int* d = row(r);
+          const int* below = row(r + 1);
+          for (int c = first_col; c < end_col; ++c) {
+            d[c] = std::min(d[c], below[c] + 1);
+          }
+        }
+        }, num_threads);
+
+      // Distance to the nearest target, in bands of rows. A chunk of bands 
+      // is processed and then written to the output.
+      const int band = 16;
+      const int chunk = 4 * band * std::max(1, num_threads);
+      std::vector<out_type> result(static_cast<std::size_t>(std::min(rows, chunk)) * cols);
+      auto o = out.begin();
+      for (int first_row = 0; first_row < rows; first_row += chunk) {
+        const int end_chunk = std::min(rows, first_row + chunk);
+        parallel_for_each_task((end_chunk - first_row + band - 1) / band, [&](int task, int) {
+          std::vector<large_int> g(cols);
+          std::vector<detail::st_pair> st;
+          const int begin_row = first_row + task * band;
+          const int end_row = std::min(end_chunk, begin_row + band);
+          for (int r = begin_row; r < end_row; ++r) {
+            std::copy(row(r), row(r) + cols, g.begin());
+            detail::process_row(g, st, inf
+              , result.data() + static_cast<std::ptrdiff_t>(r - first_row) * cols
+              , Method{}, post_processor);
+          }
+          }, num_threads);
+
+        const auto end_result = result.begin() 
+          + static_cast<std::ptrdiff_t>(end_chunk - first_row) * cols;
+        for (auto j = result.begin(); j != end_result; ++j, ++o) {
+          *o = *j;
+        }
+      }
+      return has_target;
+    }
+
+    // Return false if target is not present in raster, true otherwise
+    template<class InRaster, class OutRaster>
+    bool parallel_euclidean_distance_transform(const InRaster& in, OutRaster& out,
+      const typename traits<InRaster>::value_type& target
+      , int num_threads = default_number_of_threads())
+    {
+      return parallel_distance_transform(in, out, target, euclidean{}
+        , post_process_square_root{}, num_threads);
+    }
   }
 }
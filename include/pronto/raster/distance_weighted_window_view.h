@@ -17,7 +17,9 @@
 #include <pronto/raster/raster_allocator.h>
 #include <pronto/raster/subraster_window_view.h>
 #include <pronto/raster/uniform_raster_view.h>
+#include <cassert>
 #include <cmath> // sqrt
+#include <cstdlib> // abs
 
 
 namespace pronto {
@@ -60,7 +62,7 @@ namespace pronto {
       {
         m_kernel_radius = static_cast<int>(max_radius); // floor
         int kernel_size = 2 * m_kernel_radius + 1;
-        m_kernel = ra.allocate<WeightType>(kernel_size, kernel_size);
+        m_kernel = ra.template allocate<WeightType>(kernel_size, kernel_size);
         auto i = m_kernel.begin();
         for (int row = 0; row < kernel_size; ++row) {
           for (int col = 0; col < kernel_size; ++col, ++i) {
@@ -71,10 +73,39 @@ namespace pronto {
           }
         }
       }
+      using kernel_type = decltype(std::declval<RasterAllocator>().template allocate<WeightType>(int{}, int{}));
+
+      // A kernel of (2 * r + 1) x (2 * r + 1) weights, the window of a cell
+      // is centered on it
+      weighted_window(kernel_type kernel)
+        : m_kernel_radius(kernel.rows() / 2), m_kernel(kernel)
+      {
+        assert(kernel.rows() == kernel.cols() && kernel.rows() % 2 == 1);
+      }
+
       int m_kernel_radius;
-      using kernel_type = decltype(std::declval<RasterAllocator>().allocate<double>(int{}, int{}));
       kernel_type m_kernel;
     };
+
+    // A square window of which the weights are f(|row offset|) * f(|column
+    // offset|). For Gaussian functions this is the same as a weighted_window
+    // without the cut-off at the radius. The kernel is separable, so
+    // convolve_weighted_window does not need the FFT.
+    template<class Function, class RasterAllocator = default_raster_allocator>
+    weighted_window<RasterAllocator> make_separable_weighted_window(int radius
+      , const Function& f, RasterAllocator ra = RasterAllocator{})
+    {
+      const int kernel_size = 2 * radius + 1;
+      auto kernel = ra.template allocate<double>(kernel_size, kernel_size);
+      auto i = kernel.begin();
+      for (int row = 0; row < kernel_size; ++row) {
+        for (int col = 0; col < kernel_size; ++col, ++i) {
+          *i = f(static_cast<double>(std::abs(row - radius)))
+            * f(static_cast<double>(std::abs(col - radius)));
+        }
+      }
+      return weighted_window<RasterAllocator>(kernel);
+    }
     /*
     template<class Raster, class IndicatorGenerator, class RasterAllocator, class WeightType>
     struct distance_weighted_indicator_view_helper
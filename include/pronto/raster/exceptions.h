@@ -81,5 +81,20 @@ namespace pronto {
       const char *what() const noexcept { return "deleting raster failed"; }
     };
 
+    struct gaussian_window_sigma_too_small : public std::exception
+    {
+      const char *what() const noexcept { return "the sigma of a gaussian_window must be at least 0.5"; }
+    };
+
+    struct moving_window_indicator_without_windows : public std::exception
+    {
+      const char *what() const noexcept { return "moving_window_indicator needs at least one window"; }
+    };
+
+    struct dense_indicator_class_out_of_range : public std::exception
+    {
+      const char *what() const noexcept { return "the class of a dense indicator is not in 0, 1, ..., num_classes - 1"; }
+    };
+
   }
 }
\ No newline at end of file
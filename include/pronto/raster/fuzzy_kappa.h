@@ -13,6 +13,8 @@
 
 #include <pronto/raster/distance_transform.h>
 #include <pronto/raster/io.h>
+#include <pronto/raster/mapped_raster.h>
+#include <pronto/raster/memory_raster.h>
 #include <pronto/raster/traits.h>
 #include <pronto/raster/transform_raster_view.h>
 #include <pronto/raster/vector_of_raster_view.h>
@@ -79,6 +81,32 @@ namespace pronto {
       }
     };
 
+    class memory_raster_maker
+    {
+    public:
+      template<class T>
+      using raster_type = memory_raster<T>;
+
+      template<class T, class Model>
+      raster_type<T> create(const Model& model) const
+      {
+        return memory_raster<T>(model.rows(), model.cols());
+      }
+    };
+
+    class mapped_raster_maker
+    {
+    public:
+      template<class T>
+      using raster_type = memory_raster<T>;
+
+      template<class T, class Model>
+      raster_type<T> create(const Model& model) const
+      {
+        return create_mapped_temp<T>(model.rows(), model.cols());
+      }
+    };
+
     ////////////////////////////////////////////////////////////////////////////////
     // This function takes two distribution and returns the expected minimum value 
     // when a number is sampled from both functions
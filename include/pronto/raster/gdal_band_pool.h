@@ -0,0 +1,192 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// A GDALDataset cannot be used from multiple threads at the same time. The
+// gdal_band_pool gives each thread that reads a read-only band its own
+// GDALOpen handle to the same file. When a thread ends, its handle returns
+// to the pool and is reused by the next thread, so the number of handles is 
+// bounded by the number of threads that run at the same time. Bands that 
+// cannot be pooled (updatable or not backed by a file) are shared by all 
+// threads and the blocks of these are accessed under a mutex. The mutex 
+// belongs to the GDALDataset, so that all pools of bands of the same
+// dataset use the same mutex.
+//
+
+#pragma once
+
+#include <pronto/raster/exceptions.h>
+#include <pronto/raster/gdal_includes.h>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility> // std::move
+#include <vector>
+
+namespace pronto
+{
+  namespace raster
+  {
+    class gdal_band_pool
+    {
+    public:
+      struct thread_band
+      {
+        GDALRasterBand* band;
+        std::mutex* mutex; // nullptr when the band is not shared by threads
+      };
+
+      explicit gdal_band_pool(std::shared_ptr<GDALRasterBand> band)
+        : m_band(band), m_owner(std::this_thread::get_id())
+        , m_poolable(is_poolable(band.get()))
+        , m_shared_mutex(m_poolable ? nullptr : dataset_mutex(band.get()))
+        , m_handles(std::make_shared<handles>())
+      {}
+
+      gdal_band_pool(const gdal_band_pool&) = delete;
+      gdal_band_pool& operator=(const gdal_band_pool&) = delete;
+
+      std::shared_ptr<GDALRasterBand> get_band() const
+      {
+        return m_band;
+      }
+
+      // True if threads other than the owner get their own handle
+      bool is_pooled() const
+      {
+        return m_poolable;
+      }
+
+      // The band that the calling thread should use to access blocks.
+      thread_band get() const
+      {
+        if (!m_poolable) {
+          return thread_band{ m_band.get(), m_shared_mutex.get() };
+        }
+        const auto id = std::this_thread::get_id();
+        if (id == m_owner) {
+          return thread_band{ m_band.get(), nullptr };
+        }
+
+        std::lock_guard<std::mutex> lock(m_handles->mutex);
+        auto i = m_handles->in_use.find(id);
+        if (i == m_handles->in_use.end()) {
+          std::shared_ptr<GDALRasterBand> band;
+          if (m_handles->idle.empty()) {
+            band = open_thread_band();
+          }
+          else {
+            band = std::move(m_handles->idle.back());
+            m_handles->idle.pop_back();
+          }
+          i = m_handles->in_use.emplace(id, std::move(band)).first;
+          auto& pools = thread_handles();
+          std::erase_if(pools, [](const auto& weak) { return weak.expired(); });
+          pools.push_back(m_handles);
+        }
+        return thread_band{ i->second.get(), nullptr };
+      }
+
+    private:
+      // The handles of the pool, shared with the threads that use them
+      struct handles
+      {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<GDALRasterBand> > idle;
+        std::map<std::thread::id, std::shared_ptr<GDALRasterBand> > in_use;
+      };
+
+      // Returns the handles that the thread uses to their pools when the 
+      // thread ends
+      struct thread_exit
+      {
+        ~thread_exit()
+        {
+          const auto id = std::this_thread::get_id();
+          for (auto&& weak : pools) {
+            if (auto h = weak.lock()) {
+              std::lock_guard<std::mutex> lock(h->mutex);
+              auto i = h->in_use.find(id);
+              if (i != h->in_use.end()) {
+                h->idle.push_back(std::move(i->second));
+                h->in_use.erase(i);
+              }
+            }
+          }
+        }
+        std::vector<std::weak_ptr<handles> > pools;
+      };
+
+      static std::vector<std::weak_ptr<handles> >& thread_handles()
+      {
+        static thread_local thread_exit on_exit;
+        return on_exit.pools;
+      }
+
+      // The mutex shared by all pools of bands of the same dataset, it lives
+      // as long as any of these pools.
+      static std::shared_ptr<std::mutex> dataset_mutex(GDALRasterBand* band)
+      {
+        static std::mutex registry_mutex;
+        static std::map<const void*, std::weak_ptr<std::mutex> > registry;
+
+        const void* key = band;
+        if (band != nullptr && band->GetDataset() != nullptr) {
+          key = band->GetDataset();
+        }
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        std::erase_if(registry, [](const auto& i) { return i.second.expired(); });
+        auto& weak = registry[key];
+        auto mutex = weak.lock();
+        if (!mutex) {
+          mutex = std::make_shared<std::mutex>();
+          weak = mutex;
+        }
+        return mutex;
+      }
+
+      static bool is_poolable(GDALRasterBand* band)
+      {
+        if (band == nullptr || band->GetAccess() != GA_ReadOnly) return false;
+        GDALDataset* dataset = band->GetDataset();
+        if (dataset == nullptr || band->GetBand() < 1) return false;
+        const char* description = dataset->GetDescription();
+        if (description == nullptr || *description == '\0') return false;
+        std::error_code ec;
+        return std::filesystem::is_regular_file(description, ec);
+      }
+
+      std::shared_ptr<GDALRasterBand> open_thread_band() const
+      {
+        const char* path = m_band->GetDataset()->GetDescription();
+        GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpen(path, GA_ReadOnly));
+        if (dataset == nullptr) {
+          throw(opening_raster_failed{});
+        }
+        GDALRasterBand* band = dataset->GetRasterBand(m_band->GetBand());
+        if (band == nullptr) {
+          GDALClose(dataset);
+          throw(opening_raster_failed{});
+        }
+        return std::shared_ptr<GDALRasterBand>(band
+          , [dataset](GDALRasterBand*) { GDALClose(dataset); });
+      }
+
+      std::shared_ptr<GDALRasterBand> m_band;
+      std::thread::id m_owner;
+      bool m_poolable;
+      std::shared_ptr<std::mutex> m_shared_mutex;
+      std::shared_ptr<handles> m_handles;
+    };
+  }
+}
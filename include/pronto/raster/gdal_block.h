@@ -9,17 +9,48 @@
 
 #pragma once
 
+#include <pronto/raster/exceptions.h>
+#include <pronto/raster/gdal_block_prefetcher.h>
+#include <pronto/raster/gdal_data_type.h>
 #include <pronto/raster/gdal_includes.h>
 #include <pronto/raster/iterator_facade.h>
 #include <pronto/raster/reference_proxy.h>
 
+#include <cassert>
 #include <cstdint>
 #include <memory> //shared_ptr
+#include <mutex>
 
 namespace pronto
 {
   namespace raster
   {
+    namespace detail {
+      // GDAL does not allow the same dataset to be used from multiple 
+      // threads. When a band is shared by threads, acquiring and dirtying
+      // blocks is done under the mutex of the band (see gdal_band_pool). 
+      // Releasing a block only decrements an atomic counter.
+      inline GDALRasterBlock* get_locked_block(GDALRasterBand* band
+        , int major_row, int major_col, std::mutex* mutex)
+      {
+        if (mutex == nullptr) {
+          return band->GetLockedBlockRef(major_col, major_row);
+        }
+        std::lock_guard<std::mutex> lock(*mutex);
+        return band->GetLockedBlockRef(major_col, major_row);
+      }
+
+      inline void mark_block_dirty(GDALRasterBlock* block, std::mutex* mutex)
+      {
+        if (mutex == nullptr) {
+          block->MarkDirty();
+          return;
+        }
+        std::lock_guard<std::mutex> lock(*mutex);
+        block->MarkDirty();
+      }
+    } // detail
+
     template<class T, iteration_type IterationType = iteration_type::multi_pass, access AccessType = access::read_write>
     class block_iterator
       : public iterator_facade<block_iterator<T, IterationType, AccessType>>
@@ -34,9 +65,14 @@ namespace pronto
         : m_pos(nullptr)
       {}
 
+      // When the GDALDataType of the block corresponds to T, values are read
+      // and written directly. Only for other data types the function 
+      // pointers are used to convert between T and the native type.
       block_iterator(GDALDataType data_type, GDALAccess access_type, char* block_start)
         : m_pos(block_start)
       {
+        m_direct_get = is_native_gdal_data_type<T>(data_type);
+        m_direct_put = m_direct_get && access_type != GA_ReadOnly;
         switch (data_type)
         {
         case GDT_Byte:     set_accessors<uint8_t >(access_type);   break;
@@ -131,11 +167,19 @@ namespace pronto
    
       void put(const value_type& v) const
       {
-        m_put(v, static_cast<void*>(m_pos));
+        if (m_direct_put) {
+          *reinterpret_cast<value_type*>(m_pos) = v;
+        }
+        else {
+          m_put(v, static_cast<void*>(m_pos));
+        }
       }
 
       value_type get() const
       {
+        if (m_direct_get) {
+          return *reinterpret_cast<const value_type*>(m_pos);
+        }
         return m_get(static_cast<void*>(m_pos));
       }
       // function pointers for runtime polymorphism
@@ -143,6 +187,8 @@ namespace pronto
       value_type(*m_get)(const void* const);
       char* m_pos;
       char m_stride;
+      bool m_direct_get = false;
+      bool m_direct_put = false;
     };
 
     template<class T, iteration_type IterationType = iteration_type::multi_pass, access AccessType = access::read_write>
@@ -152,69 +198,123 @@ namespace pronto
   
       block() = default;
      
-      void reset(GDALRasterBand* band, int major_row, int major_col)
+      void reset(GDALRasterBand* band, int major_row, int major_col
+        , std::mutex* mutex = nullptr)
       {
         // Avoid rereading same block
-        if (m_block && m_block->GetBand() == band 
-          && major_row == this->major_row() && major_col == this->major_col()) 
-          return;
+        if (is_current(band, major_row, major_col)) return;
 
-        GDALRasterBlock* block = band->GetLockedBlockRef(major_col, major_row);
+        GDALRasterBlock* block = detail::get_locked_block(band, major_row, major_col, mutex);
         if (block == nullptr) {
           throw(reading_from_raster_failed{});
         }
         auto deleter = [](GDALRasterBlock* b) {b->DropLock(); };
-        m_block.reset(block, deleter);
+        m_gdal_block = block;
+        m_keep_alive.reset(block, deleter);
+        m_source = band;
+        m_data = static_cast<char*>(block->GetDataRef());
+        m_data_type = band->GetRasterDataType();
+        m_access = band->GetAccess();
+        m_block_rows = block->GetYSize();
+        m_block_cols = block->GetXSize();
+        m_major_row = major_row;
+        m_major_col = major_col;
       }
 
+      // Takes the block from the private cache of the prefetcher, these
+      // blocks are read-only
+      void reset(const gdal_block_prefetcher& prefetcher, int major_row, int major_col)
+      {
+        if (is_current(&prefetcher, major_row, major_col)) return;
+
+        std::shared_ptr<char[]> data = prefetcher.get(major_row, major_col);
+        m_gdal_block = nullptr;
+        m_keep_alive = data;
+        m_source = &prefetcher;
+        m_data = data.get();
+        m_data_type = prefetcher.data_type();
+        m_access = GA_ReadOnly;
+        m_block_rows = prefetcher.block_rows();
+        m_block_cols = prefetcher.block_cols();
+        m_major_row = major_row;
+        m_major_col = major_col;
+      }
+
+      // Moves to another block from the same source as the current block
       void reset(int major_row, int major_col)
       {
-        GDALRasterBand* band = m_block->GetBand();
-        reset(band, major_row, major_col);
+        assert(m_keep_alive);
+        if (m_gdal_block) {
+          reset(m_gdal_block->GetBand(), major_row, major_col);
+        }
+        else {
+          reset(*static_cast<const gdal_block_prefetcher*>(m_source), major_row
+            , major_col);
+        }
       }
 
       void reset()
       {
-        m_block.reset();
+        m_keep_alive.reset();
+        m_gdal_block = nullptr;
+        m_source = nullptr;
       }
 
       int block_rows() const
       {
-        return m_block->GetYSize();
+        return m_block_rows;
       }
 
       int block_cols() const
       {
-        return m_block->GetXSize();
+        return m_block_cols;
       }
 
       int major_row() const
       {
-        return m_block->GetYOff();
+        return m_major_row;
       }
 
       int major_col() const
       {
-        return m_block->GetXOff();
+        return m_major_col;
       }
 
       iterator begin() const
       {
-        char* block_start = static_cast<char*>(m_block->GetDataRef());
-
-        auto data_type = m_block->GetBand()->GetRasterDataType();
-        auto access_type = m_block->GetBand()->GetAccess();
+        return iterator(m_data_type, m_access, m_data);
+      }
 
-        return iterator(data_type, access_type, block_start);
+      char* data() const
+      {
+        return m_data;
       }
  
-      void mark_dirty() const //mutable
+      void mark_dirty(std::mutex* mutex = nullptr) const //mutable
       {
-        m_block->MarkDirty();
+        if (m_gdal_block) {
+          detail::mark_block_dirty(m_gdal_block, mutex);
+        }
       }
 
     private:
-      mutable std::shared_ptr<GDALRasterBlock> m_block;
+      bool is_current(const void* source, int major_row, int major_col) const
+      {
+        return m_keep_alive && m_source == source
+          && major_row == m_major_row && major_col == m_major_col;
+      }
+
+      // Either the locked GDALRasterBlock or the prefetched data
+      std::shared_ptr<void> m_keep_alive;
+      GDALRasterBlock* m_gdal_block = nullptr;
+      const void* m_source = nullptr;
+      char* m_data = nullptr;
+      GDALDataType m_data_type = GDT_Unknown;
+      GDALAccess m_access = GA_ReadOnly;
+      int m_block_rows = 0;
+      int m_block_cols = 0;
+      int m_major_row = 0;
+      int m_major_col = 0;
     };
   }
 }
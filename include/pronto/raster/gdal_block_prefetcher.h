@@ -0,0 +1,217 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// Reading a block of a compressed raster means decompressing it, this is
+// slow compared to the computations done on the cells. The
+// gdal_block_prefetcher reads the blocks of a read-only band in a background
+// thread, in the order in which they are visited by row-major iteration,
+// while the compute thread works on the blocks that are already read.
+//
+// The blocks of the GDAL cache belong to a GDALDataset, which cannot be
+// shared by threads. Therefore the background thread reads via its own
+// handle (see gdal_band_pool) into a private cache. This cache keeps all
+// blocks of the current strip, because row-major iteration revisits them
+// for every row, and the given number of blocks ahead of it.
+//
+
+#pragma once
+
+#include <pronto/raster/exceptions.h>
+#include <pronto/raster/gdal_band_pool.h>
+#include <pronto/raster/gdal_includes.h>
+
+#include <condition_variable>
+#include <cstddef> // std::size_t
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace pronto
+{
+  namespace raster
+  {
+    class gdal_block_prefetcher
+    {
+    public:
+      // Prefetches the blocks that overlap the window of rows x cols cells
+      // starting at (first_row, first_col). The band of the pool must be
+      // pooled, so the background thread can use its own handle.
+      gdal_block_prefetcher(std::shared_ptr<gdal_band_pool> pool
+        , int first_row, int first_col, int rows, int cols, int blocks_ahead)
+        : m_pool(pool)
+      {
+        GDALRasterBand* band = pool->get_band().get();
+        band->GetBlockSize(&m_block_cols, &m_block_rows);
+        m_data_type = band->GetRasterDataType();
+        m_block_bytes = static_cast<std::size_t>(m_block_rows) * m_block_cols
+          * (GDALGetDataTypeSize(m_data_type) / 8);
+
+        m_first_major_row = first_row / m_block_rows;
+        m_first_major_col = first_col / m_block_cols;
+        const int last_major_row = (first_row + rows - 1) / m_block_rows;
+        const int last_major_col = (first_col + cols - 1) / m_block_cols;
+        m_major_cols = last_major_col - m_first_major_col + 1;
+        m_num_blocks = rows > 0 && cols > 0
+          ? (last_major_row - m_first_major_row + 1) * m_major_cols : 0;
+        m_capacity = m_major_cols + blocks_ahead;
+
+        m_thread = std::thread([this] { run(); });
+      }
+
+      gdal_block_prefetcher(const gdal_block_prefetcher&) = delete;
+      gdal_block_prefetcher& operator=(const gdal_block_prefetcher&) = delete;
+
+      ~gdal_block_prefetcher()
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stop = true;
+        }
+        m_producer_cv.notify_all();
+        m_thread.join();
+      }
+
+      GDALDataType data_type() const
+      {
+        return m_data_type;
+      }
+
+      int block_rows() const
+      {
+        return m_block_rows;
+      }
+
+      int block_cols() const
+      {
+        return m_block_cols;
+      }
+
+      // The data of the block, waits for the background thread if it is
+      // about to read the block. Blocks outside of the prefetched range are
+      // read by the calling thread.
+      std::shared_ptr<char[]> get(int major_row, int major_col) const
+      {
+        const int i = index(major_row, major_col);
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          if (i >= 0 && i < m_num_blocks) {
+            move_window(i - i % m_major_cols);
+            m_consumer_cv.wait(lock, [&] {
+              return m_failed || !in_window(i) || m_cache.contains(i); });
+            auto found = m_cache.find(i);
+            if (found != m_cache.end()) {
+              return found->second;
+            }
+          }
+        }
+        return read(m_pool->get().band, major_row, major_col);
+      }
+
+    private:
+      int index(int major_row, int major_col) const
+      {
+        const int col = major_col - m_first_major_col;
+        if (col < 0 || col >= m_major_cols) return -1;
+        return (major_row - m_first_major_row) * m_major_cols + col;
+      }
+
+      bool in_window(int i) const
+      {
+        return i >= m_window_first && i < m_window_first + m_capacity;
+      }
+
+      // The window starts at the strip that is currently visited, blocks
+      // outside the window are no longer needed. Called under the mutex.
+      void move_window(int first) const
+      {
+        if (first == m_window_first) return;
+        // Going back, evicted blocks before m_next have to be read again
+        const bool back = first < m_window_first;
+        m_window_first = first;
+        std::erase_if(m_cache, [&](const auto& block) {
+          return !in_window(block.first); });
+        if (back || !in_window(m_next)) {
+          m_next = first;
+        }
+        m_producer_cv.notify_all();
+      }
+
+      std::shared_ptr<char[]> read(GDALRasterBand* band, int major_row
+        , int major_col) const
+      {
+        std::shared_ptr<char[]> data(new char[m_block_bytes]);
+        if (band->ReadBlock(major_col, major_row, data.get()) != CE_None) {
+          throw(reading_from_raster_failed{});
+        }
+        return data;
+      }
+
+      void run()
+      {
+        // The first call to get() from this thread opens its own handle
+        GDALRasterBand* band = nullptr;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+          m_producer_cv.wait(lock, [&] { return m_stop
+            || (m_next < m_num_blocks && in_window(m_next)); });
+          if (m_stop) return;
+
+          const int i = m_next;
+          if (!m_cache.contains(i)) {
+            lock.unlock();
+            std::shared_ptr<char[]> data;
+            try {
+              if (band == nullptr) band = m_pool->get().band;
+              data = read(band, m_first_major_row + i / m_major_cols
+                , m_first_major_col + i % m_major_cols);
+            }
+            catch (...) {
+              // The compute thread will read the block itself and throw
+              lock.lock();
+              m_failed = true;
+              m_consumer_cv.notify_all();
+              return;
+            }
+            lock.lock();
+            if (in_window(i)) {
+              m_cache.emplace(i, data);
+            }
+          }
+          if (m_next == i) {
+            ++m_next;
+          }
+          m_consumer_cv.notify_all();
+        }
+      }
+
+      std::shared_ptr<gdal_band_pool> m_pool;
+      GDALDataType m_data_type;
+      int m_block_rows;
+      int m_block_cols;
+      std::size_t m_block_bytes;
+      int m_first_major_row;
+      int m_first_major_col;
+      int m_major_cols;
+      int m_num_blocks;
+      int m_capacity;
+
+      // Blocks are indexed in row-major order, relative to the first block
+      mutable std::mutex m_mutex;
+      mutable std::condition_variable m_producer_cv;
+      mutable std::condition_variable m_consumer_cv;
+      mutable std::map<int, std::shared_ptr<char[]> > m_cache;
+      mutable int m_window_first = 0;
+      mutable int m_next = 0;
+      bool m_stop = false;
+      bool m_failed = false;
+      std::thread m_thread;
+    };
+  }
+}
@@ -0,0 +1,112 @@
+//
+//=======================================================================
+// Copyright 2015-2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// Compile-time association between C++ value types and GDALDataType
+//
+
+#pragma once
+
+#include <pronto/raster/gdal_includes.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace pronto
+{
+  namespace raster
+  {
+    namespace detail {
+      template<typename T> struct native_gdal_data_type
+      {
+        static const GDALDataType value = GDT_Unknown;
+      };
+
+      template<> struct native_gdal_data_type<int32_t>
+      {
+        static const GDALDataType value = GDT_Int32;
+      };
+
+      template<>
+      struct native_gdal_data_type<uint32_t>
+      {
+        static const GDALDataType value = GDT_UInt32;
+      };
+
+      template<> struct native_gdal_data_type<int16_t>
+      {
+        static const GDALDataType value = GDT_Int16;
+      };
+
+      template<> struct native_gdal_data_type<uint16_t>
+      {
+        static const GDALDataType value = GDT_UInt16;
+      };
+
+      template<> struct native_gdal_data_type<uint8_t>
+      {
+        static const GDALDataType value = GDT_Byte;
+      };
+
+      template<> struct native_gdal_data_type<bool>
+      {
+        static const GDALDataType value = GDT_Byte;
+      };
+
+      template<> struct native_gdal_data_type<float>
+      {
+        static const GDALDataType value = GDT_Float32;
+      };
+
+      template<> struct native_gdal_data_type<double>
+      {
+        static const GDALDataType value = GDT_Float64;
+      };
+  /*
+      template<> struct native_gdal_data_type<cint16_t>
+      {
+        static const GDALDataType value = GDT_CInt16;
+      };
+
+      template<> struct native_gdal_data_type<cint32_t>
+      {
+        static const GDALDataType value = GDT_CInt32;
+      };
+      template<> struct native_gdal_data_type<cfloat32_t>
+      {
+        static const GDALDataType value = GDT_CFloat32;
+      };
+      template<> struct native_gdal_data_type<cfloat64_t>
+      {
+        static const GDALDataType value = GDT_CFloat64;
+      };
+
+      */
+    } // detail
+
+    template<class T>
+    static const GDALDataType gdal_data_type = detail::native_gdal_data_type<T>::value;
+
+    // True when RasterIO can read into and write from buffers of T
+    template<class T>
+    constexpr bool is_raster_io_type_v = !std::is_same_v<T, bool>
+      && detail::native_gdal_data_type<T>::value != GDT_Unknown;
+
+    // True when a GDAL buffer of data_type can be read and written as T
+    // without conversion. bool is stored as GDT_Byte, but any byte value
+    // other than 0 or 1 is not a valid bool, so it always takes the
+    // converting path.
+    template<class T>
+    constexpr bool is_native_gdal_data_type(GDALDataType data_type)
+    {
+      return !std::is_same_v<T, bool>
+        && detail::native_gdal_data_type<T>::value != GDT_Unknown
+        && detail::native_gdal_data_type<T>::value == data_type;
+    }
+  }
+}
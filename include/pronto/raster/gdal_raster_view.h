@@ -15,18 +15,51 @@
 
 #include <pronto/raster/access_type.h>
 #include <pronto/raster/exceptions.h>
+#include <pronto/raster/gdal_band_pool.h>
 #include <pronto/raster/gdal_block.h>
+#include <pronto/raster/gdal_block_prefetcher.h>
 #include <pronto/raster/gdal_includes.h>
 #include <pronto/raster/gdal_raster_iterator.h>
+#include <pronto/raster/stretch.h>
 
+#include <algorithm> // std::min
+#include <cassert>
+#include <cstring> // std::memcmp
 #include <memory> //shared_ptr
+#include <mutex>
 #include <ranges>
 #include <optional>
+#include <span>
+#include <type_traits>
 
 namespace pronto
 {
   namespace raster
   {
+    namespace detail {
+      // Reads or writes a window of the band in one RasterIO call, data is
+      // in row-major order. GDAL converts between the data type of the band
+      // and U.
+      template<class U>
+      void raster_io(const gdal_band_pool& pool, GDALRWFlag flag
+        , int first_row, int first_col, int rows, int cols, U* data)
+      {
+        static_assert(is_raster_io_type_v<U>
+          , "the buffer must be of a type that corresponds to a GDALDataType");
+        const gdal_band_pool::thread_band thread_band = pool.get();
+        std::unique_lock<std::mutex> lock;
+        if (thread_band.mutex) {
+          lock = std::unique_lock<std::mutex>(*thread_band.mutex);
+        }
+        CPLErr err = thread_band.band->RasterIO(flag, first_col, first_row
+          , cols, rows, data, cols, rows, gdal_data_type<U>, 0, 0);
+        if (err != CE_None) {
+          if (flag == GF_Read) throw(reading_from_raster_failed{});
+          throw(writing_to_raster_failed{});
+        }
+      }
+    } // detail
+
       class gdal_raster_view_base
       {
       public:
@@ -52,6 +85,7 @@ namespace pronto
       {
         if (!band) throw(gdal_raster_view_works_on_unitialized_band{});
         m_band = band;
+        m_pool = std::make_shared<gdal_band_pool>(band);
         m_rows = band->GetYSize();
         m_cols = band->GetXSize();
         m_first_row = 0;
@@ -124,7 +158,7 @@ namespace pronto
 
       gdal_raster_view sub_raster(int first_row, int first_col, int rows, int cols) const
       {
-        gdal_raster_view out{m_band};
+        gdal_raster_view out = *this; // shares the band pool
         out.m_first_row = m_first_row + first_row;
         out.m_first_col = m_first_col + first_col;
         out.m_rows = rows;
@@ -192,16 +226,137 @@ namespace pronto
       {
         if (!m_band) throw(gdal_raster_view_works_on_unitialized_band{});
 
-        block.reset(m_band.get(), block_row, block_col);
+        if (m_prefetcher) {
+          block.reset(*m_prefetcher, block_row, block_col);
+          return;
+        }
+        // each thread accesses the blocks via its own band if possible
+        const gdal_band_pool::thread_band thread_band = m_pool->get();
+        block.reset(thread_band.band, block_row, block_col, thread_band.mutex);
         if constexpr (is_mutable) {
           if(m_band->GetAccess() == GA_Update) {
-             block.mark_dirty();
+             block.mark_dirty(thread_band.mutex);
+          }
+        }
+      }
+
+      // Returns a copy of the view for which the blocks are read by a
+      // background thread, up to blocks_ahead blocks beyond the current strip
+      // of blocks (by default one strip). This only applies to bands that
+      // are opened read-only from file, for other bands the copy reads
+      // blocks as usual. Copies and sub-rasters of the returned view share
+      // the prefetcher, it follows the blocks requested most recently and
+      // is therefore most effective when used by a single thread.
+      gdal_raster_view with_prefetch(int blocks_ahead = -1) const
+      {
+        if (!m_band) throw(gdal_raster_view_works_on_unitialized_band{});
+        gdal_raster_view out = *this;
+        if (m_pool->is_pooled() && size() > 0) {
+          if (blocks_ahead < 0) {
+            const int block_cols = get_block_cols();
+            blocks_ahead = (m_first_col + m_cols - 1) / block_cols
+              - m_first_col / block_cols + 1;
           }
+          out.m_prefetcher = std::make_shared<gdal_block_prefetcher>(m_pool
+            , m_first_row, m_first_col, m_rows, m_cols, blocks_ahead);
         }
+        return out;
+      }
+
+      static const bool has_stretches = true;
+      static const bool has_mutable_stretches = is_mutable;
+      using stretch_type = std::conditional_t<is_mutable, std::span<T>, std::span<const T> >;
+
+      // Calls f(row, col, stretch) for the part of each row that falls in
+      // one GDAL block. When the GDALDataType of the band corresponds to T
+      // the stretch refers to the block directly, otherwise values are
+      // converted via a buffer (and written back if the band is updatable).
+      // Mutable stretches of bands that are not updatable, or that are 
+      // prefetched, are always copies so GDAL's blocks are not changed. As 
+      // for the iterators, writing to these throws.
+      template<class F>
+      void for_each_stretch(F&& f) const
+      {
+        if (!m_band) throw(gdal_raster_view_works_on_unitialized_band{});
+        const int block_rows = get_block_rows();
+        const int block_cols = get_block_cols();
+        const bool native = is_native_gdal_data_type<T>(m_band->GetRasterDataType());
+        const bool write_back = is_mutable && m_band->GetAccess() == GA_Update
+          && !m_prefetcher;
+        const bool direct = native && (!is_mutable || write_back);
+        const int buffer_size = std::min(block_cols, m_cols);
+        std::unique_ptr<T[]> buffer;
+        std::unique_ptr<T[]> original;
+        if (!direct) buffer = std::make_unique<T[]>(buffer_size);
+        if (is_mutable && !write_back) original = std::make_unique<T[]>(buffer_size);
+
+        block_type block;
+        detail::for_each_block_stretch(m_first_row, m_first_col, m_rows, m_cols
+          , block_rows, block_cols
+          , [&](int row, int col, int major_row, int major_col
+            , int minor_row, int minor_col, int n)
+          {
+            reset_block(block, major_row, major_col);
+            const int index_in_block = minor_row * block_cols + minor_col;
+            if (direct) {
+              T* first = reinterpret_cast<T*>(block.data()) + index_in_block;
+              f(row, col, stretch_type(first, n));
+              return;
+            }
+            if (native) {
+              const T* first = reinterpret_cast<const T*>(block.data()) + index_in_block;
+              std::copy(first, first + n, buffer.get());
+            }
+            else {
+              auto first = block.begin() + index_in_block;
+              for (int i = 0; i < n; ++i) {
+                buffer[i] = first.get();
+                ++first;
+              }
+            }
+            if (original) std::copy(buffer.get(), buffer.get() + n, original.get());
+            f(row, col, stretch_type(buffer.get(), n));
+            if constexpr (is_mutable) {
+              if (write_back) {
+                auto first = block.begin() + index_in_block;
+                for (int i = 0; i < n; ++i) {
+                  first.put(buffer[i]);
+                  ++first;
+                }
+              }
+              else if (std::memcmp(buffer.get(), original.get(), n * sizeof(T)) != 0) {
+                throw(writing_to_raster_failed{});
+              }
+            }
+          });
+      }
+
+      // Reads all cells of the (sub-)raster into out in row-major order,
+      // out must have room for size() values. This uses a single RasterIO
+      // call, in which GDAL converts from the data type of the band to U.
+      template<class U>
+      void read_into(std::span<U> out) const
+      {
+        if (!m_band) throw(gdal_raster_view_works_on_unitialized_band{});
+        assert(out.size() >= static_cast<std::size_t>(size()));
+        detail::raster_io(*m_pool, GF_Read, m_first_row, m_first_col
+          , m_rows, m_cols, out.data());
+      }
+
+      // Writes size() values in row-major order to the (sub-)raster
+      template<class U>
+      void write_from(std::span<const U> in) const requires is_mutable
+      {
+        if (!m_band) throw(gdal_raster_view_works_on_unitialized_band{});
+        assert(in.size() >= static_cast<std::size_t>(size()));
+        detail::raster_io(*m_pool, GF_Write, m_first_row, m_first_col
+          , m_rows, m_cols, const_cast<U*>(in.data()));
       }
 
     private:
       std::shared_ptr<GDALRasterBand> m_band;
+      std::shared_ptr<gdal_band_pool> m_pool;
+      std::shared_ptr<gdal_block_prefetcher> m_prefetcher;
       int m_rows;
       int m_cols;
       int m_first_row;
@@ -9,6 +9,9 @@
 
 #pragma once
 
+#include <cmath> // std::llround
+#include <type_traits>
+
 namespace pronto{
   namespace raster {
 
@@ -18,6 +21,21 @@ namespace pronto{
       count() : m_count(0)
       {}
 
+      // The sum of the samples is not used
+      static const bool is_linear_accumulator = true;
+
+      // The weight may be off by rounding errors (e.g. 48.9999999 after a
+      // convolution), integral counts are therefore rounded
+      void set_weight_and_sum(double weight, double)
+      {
+        if constexpr (std::is_integral_v<Weight>) {
+          m_count = static_cast<Weight>(std::llround(weight));
+        }
+        else {
+          m_count = static_cast<Weight>(weight);
+        }
+      }
+
       void add_sample(const ValueType&, const Weight& w)
       {
         m_count += w;
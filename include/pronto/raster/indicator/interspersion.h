@@ -11,12 +11,16 @@
 
 #pragma once
 
+#include <pronto/raster/exceptions.h>
 #include <pronto/raster/optional.h>
 
+#include <cassert>
 #include <cmath>
+#include <cstddef> // std::size_t
 #include <set>
 #include <map>
 #include <utility>
+#include <vector>
 
 namespace pronto {
   namespace raster {
@@ -77,7 +81,7 @@ namespace pronto {
         }
       }
 
-      optional<double> extract() const
+      std::optional<double> extract() const
       {
         double numerator = 0;
         std::set<T> categories;
@@ -122,5 +126,143 @@ namespace pronto {
         return indicator{};
       }
     };
+
+    // For categorical rasters with classes 0, 1, ..., num_classes - 1. The
+    // edge counts are kept in a flat lower-triangular matrix, together with
+    // the number of edges of each class, the number of classes with edges
+    // and the sum of n * log(n) over the edge counts. With N edges the sum
+    // of f * log(f) over the edge fractions f = n / N is then
+    // sum(n * log(n)) / N - log(N), so extract is O(1). Edges with sides of
+    // other classes throw dense_indicator_class_out_of_range.
+    template<typename T> // value type of the edge sides
+    struct dense_interspersion
+    {
+    private:
+      using edge_type = std::pair<T, T>;
+
+    public:
+      dense_interspersion(int num_classes = 0)
+        : m_edges(static_cast<std::size_t>(num_classes) * (num_classes - 1) / 2, 0)
+        , m_class_edges(num_classes, 0), m_num_classes(0), m_total(0)
+        , m_sum_n_log_n(0)
+      {}
+
+      void add_sample(const edge_type& edge)
+      {
+        if (edge.first != edge.second) {
+          add(index(edge.first), index(edge.second), 1);
+        }
+      }
+
+      void subtract_sample(const edge_type& edge)
+      {
+        if (edge.first != edge.second) {
+          add(index(edge.first), index(edge.second), -1);
+        }
+      }
+
+      void add_subtotal(const dense_interspersion& subtotal)
+      {
+        subtotal.for_each_edge_count([&](int a, int b, int count) {
+          add(a, b, count); });
+      }
+
+      void subtract_subtotal(const dense_interspersion& subtotal)
+      {
+        subtotal.for_each_edge_count([&](int a, int b, int count) {
+          add(a, b, -count); });
+      }
+
+      std::optional<double> extract() const
+      {
+        const int m = m_num_classes;
+
+        // Need at least three categories to calculate interspersion
+        if (m < 3) return std::nullopt;
+
+        const double numerator = m_sum_n_log_n / m_total - std::log(m_total);
+        const double nominator = -std::log(0.5 * m * (m - 1));
+        return numerator / nominator;
+      }
+
+    private:
+      int index(const T& v) const
+      {
+        const int c = static_cast<int>(v);
+        if (c < 0 || c >= static_cast<int>(m_class_edges.size())) {
+          throw(dense_indicator_class_out_of_range{});
+        }
+        return c;
+      }
+
+      static double n_log_n(int n)
+      {
+        return n > 0 ? n * std::log(static_cast<double>(n)) : 0.0;
+      }
+
+      // a and b are different classes, in any order
+      void add(int a, int b, int count)
+      {
+        if (a < b) std::swap(a, b);
+        int& n = m_edges[static_cast<std::size_t>(a) * (a - 1) / 2 + b];
+
+        // can only remove edges that are there
+        assert(n + count >= 0);
+
+        m_sum_n_log_n += n_log_n(n + count) - n_log_n(n);
+        n += count;
+        m_total += count;
+        update_class(a, count);
+        update_class(b, count);
+
+        // avoid the accumulation of rounding errors
+        if (m_total == 0) m_sum_n_log_n = 0;
+      }
+
+      void update_class(int c, int count)
+      {
+        const bool had_edges = m_class_edges[c] > 0;
+        m_class_edges[c] += count;
+        m_num_classes += (m_class_edges[c] > 0) - had_edges;
+      }
+
+      // Calls f(a, b, count) for each pair of classes with edges, only
+      // visits classes that have edges
+      template<class F>
+      void for_each_edge_count(F&& f) const
+      {
+        const int n = static_cast<int>(m_class_edges.size());
+        for (int a = 1; a < n; ++a) {
+          if (m_class_edges[a] == 0) continue;
+          const int* row = m_edges.data() + static_cast<std::size_t>(a) * (a - 1) / 2;
+          for (int b = 0; b < a; ++b) {
+            if (row[b] != 0) f(a, b, row[b]);
+          }
+        }
+      }
+
+      std::vector<int> m_edges;
+      std::vector<int> m_class_edges;
+      int m_num_classes;
+      int m_total;
+      double m_sum_n_log_n;
+    };
+
+    template<class T>
+    struct dense_interspersion_generator
+    {
+      using indicator = dense_interspersion<T>;
+
+      explicit dense_interspersion_generator(int num_classes)
+        : num_classes(num_classes)
+      {}
+
+      indicator operator()() const
+      {
+        return indicator(num_classes);
+      }
+
+      int num_classes;
+    };
   }
 } 
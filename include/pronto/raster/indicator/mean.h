@@ -24,6 +24,14 @@ namespace pronto {
       using value_type = SampleType;
       using weight_type = WeightType;
 
+      static const bool is_linear_accumulator = true;
+
+      void set_weight_and_sum(double w, double s)
+      {
+        weight = w;
+        sum = s;
+      }
+
       void add_sample(const value_type& v, const weight_type& w)
       {
         weight += w;
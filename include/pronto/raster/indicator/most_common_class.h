@@ -9,10 +9,14 @@
 
 #pragma once
 
+#include <pronto/raster/exceptions.h>
 #include <pronto/raster/traits.h>
 #include <pronto/raster/optional.h>
 
+#include <algorithm> // std::max
+#include <cassert>
 #include <iterator>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <map>
@@ -214,32 +218,32 @@ namespace pronto {
 
       }
 
-      template<typename Weight>
-      void add_subtotal(const most_common_class& subtotal, const Weight& w)
+      template<typename W>
+      void add_subtotal(const most_common_class& subtotal, const W& w)
       {
-        for (auto&& i : *subtotal.m_counts) {
+        for (auto&& i : subtotal.m_counts) {
           m_counts.add(i.first,i.second * w);
         }
       }
 
       void add_subtotal(const most_common_class& subtotal)
       {
-        for (auto&& i : *subtotal.m_counts) {
+        for (auto&& i : subtotal.m_counts) {
           m_counts.add(i.first, i.second);
         }
       }
 
-      template<typename Weight>
-      void subtract_subtotal(const most_common_class& subtotal, const Weight& w)
+      template<typename W>
+      void subtract_subtotal(const most_common_class& subtotal, const W& w)
       {
-        for (auto&& i : *subtotal.m_counts) {
+        for (auto&& i : subtotal.m_counts) {
           m_counts.subtract(i.first, i.second * w);
         }
       }
 
       void subtract_subtotal(const most_common_class& subtotal)
       {
-        for (auto&& i : *subtotal.m_counts) {
+        for (auto&& i : subtotal.m_counts) {
           m_counts.subtract(i.first, i.second);
         }
       }
@@ -264,5 +268,156 @@ namespace pronto {
         return indicator{};
       }
     };
+
+    // For categorical rasters with classes 0, 1, ..., num_classes - 1. The
+    // counts are kept in a flat array indexed by class. Classes with the
+    // same count are kept in a doubly-linked list (as indices into flat
+    // arrays) per count, so the maximum count and a class that has it are
+    // maintained in constant time per sample. Memory is allocated when the
+    // indicator is created, and when a count exceeds all previous counts.
+    // Weights must be integers. Samples of other classes throw 
+    // dense_indicator_class_out_of_range.
+    //
+    // Each indicator holds three arrays of num_classes and an array of the
+    // largest count. The moving window views keep an indicator per column 
+    // as subtotal, i.e. about cols * (3 * num_classes + largest count)
+    // values, and make a new indicator at the start of each row. For many 
+    // classes on wide rasters the sparse most_common_class can use less 
+    // memory.
+    template<typename T, typename Weight = int>
+    struct dense_most_common_class
+    {
+      static_assert(std::is_integral_v<Weight>, "counts must be integers");
+      using value_type = T;
+
+      dense_most_common_class(int num_classes = 0)
+        : m_counts(num_classes, 0), m_next(num_classes, -1)
+        , m_previous(num_classes, -1), m_heads(1, -1), m_max(0)
+      {}
+
+      void add_sample(const value_type& v, const Weight& w)
+      {
+        const int c = index(v);
+        set_count(c, m_counts[c] + w);
+      }
+
+      void add_sample(const value_type& v)
+      {
+        add_sample(v, 1);
+      }
+
+      void subtract_sample(const value_type& v, const Weight& w)
+      {
+        const int c = index(v);
+        set_count(c, m_counts[c] - w);
+      }
+
+      void subtract_sample(const value_type& v)
+      {
+        subtract_sample(v, 1);
+      }
+
+      void add_subtotal(const dense_most_common_class& subtotal, const Weight& w)
+      {
+        subtotal.for_each_count([&](int c, Weight count) {
+          set_count(c, m_counts[c] + count * w); });
+      }
+
+      void add_subtotal(const dense_most_common_class& subtotal)
+      {
+        subtotal.for_each_count([&](int c, Weight count) {
+          set_count(c, m_counts[c] + count); });
+      }
+
+      void subtract_subtotal(const dense_most_common_class& subtotal, const Weight& w)
+      {
+        subtotal.for_each_count([&](int c, Weight count) {
+          set_count(c, m_counts[c] - count * w); });
+      }
+
+      void subtract_subtotal(const dense_most_common_class& subtotal)
+      {
+        subtotal.for_each_count([&](int c, Weight count) {
+          set_count(c, m_counts[c] - count); });
+      }
+
+      std::optional<T> extract() const
+      {
+        if (m_max == 0) return std::nullopt;
+        return static_cast<T>(m_heads[m_max]);
+      }
+
+    private:
+      int index(const value_type& v) const
+      {
+        const int c = static_cast<int>(v);
+        if (c < 0 || c >= static_cast<int>(m_counts.size())) {
+          throw(dense_indicator_class_out_of_range{});
+        }
+        return c;
+      }
+
+      // Calls f(class, count) for the classes with a positive count. Loops
+      // over the counts, not the classes. f must not change this indicator.
+      template<class F>
+      void for_each_count(F&& f) const
+      {
+        for (Weight count = 1; count <= m_max; ++count) {
+          for (int c = m_heads[count]; c != -1; c = m_next[c]) {
+            f(c, count);
+          }
+        }
+      }
+
+      void set_count(int c, Weight count)
+      {
+        assert(count >= 0);
+        const Weight old_count = m_counts[c];
+        if (old_count == count) return;
+        if (old_count > 0) {
+          if (m_previous[c] != -1) m_next[m_previous[c]] = m_next[c];
+          else m_heads[old_count] = m_next[c];
+          if (m_next[c] != -1) m_previous[m_next[c]] = m_previous[c];
+        }
+        m_counts[c] = count;
+        if (count > 0) {
+          if (count >= static_cast<Weight>(m_heads.size())) {
+            m_heads.resize(std::max(static_cast<std::size_t>(count) + 1
+              , 2 * m_heads.size()), -1);
+          }
+          m_previous[c] = -1;
+          m_next[c] = m_heads[count];
+          if (m_next[c] != -1) m_previous[m_next[c]] = c;
+          m_heads[count] = c;
+        }
+        m_max = std::max(m_max, count);
+        while (m_max > 0 && m_heads[m_max] == -1) {
+          --m_max;
+        }
+      }
+
+      std::vector<Weight> m_counts;
+      std::vector<int> m_next;
+      std::vector<int> m_previous;
+      std::vector<int> m_heads; // first class for each count
+      Weight m_max;
+    };
+
+    template<class T>
+    struct dense_most_common_class_generator
+    {
+      using indicator = dense_most_common_class<T>;
+
+      explicit dense_most_common_class_generator(int num_classes)
+        : num_classes(num_classes)
+      {}
+
+      indicator operator()() const
+      {
+        return indicator(num_classes);
+      }
+
+      int num_classes;
+    };
   } 
 }
@@ -13,6 +13,7 @@
 #include <pronto/raster/patch_raster_transform.h>
 
 #include <cmath> //sqrt
+#include <cstdint>
 
 namespace pronto {
   namespace raster {
@@ -29,8 +30,9 @@ namespace pronto {
 
       double calculate_shape_index(const patch_info& p)
       {
-        int n = static_cast<int>(std::sqrt(p.m_area));
-        int min_perimeter;
+        const std::int64_t n = static_cast<std::int64_t>(
+          std::sqrt(static_cast<double>(p.m_area)));
+        std::int64_t min_perimeter;
         if (p.m_area == n * n) {
           min_perimeter = 4 * n;
         }
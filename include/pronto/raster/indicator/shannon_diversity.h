@@ -11,7 +11,8 @@
 
 #include <pronto/raster/optional.h>
 
-#include <numeric>
+#include <algorithm> // std::max
+#include <cmath>
 #include <utility>
 #include <vector>
 
@@ -20,101 +21,132 @@ namespace pronto {
 
     struct counted_vector
     {
-      void increment(int index, double w)
+      counted_vector(int size = 0) : counts(size, 0)
+      {}
+
+      // Returns the count before the increment
+      double increment(int index, double w)
       {
-        for (int i = static_cast<int>(counts.size()); i <= index; ++i)  {
-          counts.push_back(0);
+        if (index >= static_cast<int>(counts.size())) {
+          counts.resize(index + 1, 0);
         }
+        const double old_count = counts[index];
         counts[index] += w;
+        return old_count;
       }
 
-      void decrement(int index, double w)
+      // Returns the count before the decrement
+      double decrement(int index, double w)
       {
+        const double old_count = counts[index];
         counts[index] -= w;
+        return old_count;
       }
 
       std::vector<double> counts;
     };
+
+    // The entropy of the counts c with total t is log(t) - sum(c * log(c)) / t,
+    // the total and the sum of c * log(c) are maintained for each sample, so
+    // extract is O(1).
     struct shannon_diversity
     {
       using value_type = int;
       using weight_type = double;
 
+      shannon_diversity(int num_classes = 0) : cv(num_classes)
+      {}
+
       void add_sample(const value_type& v, const weight_type& w)
       {
-        cv.increment(v, w);
+        const double old_count = cv.increment(v, w);
+        update(old_count, old_count + w);
       }
 
       void add_sample(const value_type& v)
       {
-        cv.increment(v, 1.0);
+        add_sample(v, 1.0);
       }
 
       void subtract_sample(const value_type& v, const weight_type& w)
       {
-         cv.decrement(v, w);
+        const double old_count = cv.decrement(v, w);
+        update(old_count, old_count - w);
       }
 
       void subtract_sample(const value_type& v)
       {
-        cv.decrement(v, 1.0);
+        subtract_sample(v, 1.0);
       }
 
       void add_subtotal(const shannon_diversity& subtotal, const weight_type& w)
       {
         const int n = static_cast<int>(subtotal.cv.counts.size());
         for (int i = 0; i < n; ++i) {
-          add_sample(i, subtotal.cv.counts[i] * w);
+          if (subtotal.cv.counts[i] != 0) add_sample(i, subtotal.cv.counts[i] * w);
         }
       }
 
       void add_subtotal(const shannon_diversity& subtotal)
       {
-        const int n = static_cast<int>(subtotal.cv.counts.size());
-        for (int i = 0; i < n; ++i) {
-          add_sample(i, subtotal.cv.counts[i]);
-        }
+        add_subtotal(subtotal, 1.0);
       }
 
       void subtract_subtotal(const shannon_diversity& subtotal, const weight_type& w)
       {
         const int n = static_cast<int>(subtotal.cv.counts.size());
         for (int i = 0; i < n; ++i) {
-          subtract_sample(i, subtotal.cv.counts[i] * w);
+          if (subtotal.cv.counts[i] != 0) subtract_sample(i, subtotal.cv.counts[i] * w);
         }
       }
 
       void subtract_subtotal(const shannon_diversity& subtotal)
       {
-        const int n = static_cast<int>(subtotal.cv.counts.size());
-        for (int i = 0; i < n; ++i) {
-          subtract_sample(i, subtotal.cv.counts[i]);
-        }
+        subtract_subtotal(subtotal, 1.0);
       }
 
       double extract() const
       {
-        double sum = 0;
-        sum = std::accumulate(cv.counts.begin(), cv.counts.end(), sum);
-        double h = 0;
-        for (auto i : cv.counts) {
-          if (i > 0) {
-            const double pi = i / sum;
-            h -= pi * std::log(pi);
-          }
-        }
-        return h;
+        if (total <= 0) return 0;
+        // not below zero due to rounding
+        return std::max(0.0, std::log(total) - sum_c_log_c / total);
       }
+
       counted_vector cv;
+      double total = 0;
+      double sum_c_log_c = 0;
+
+    private:
+      static double c_log_c(double c)
+      {
+        return c > 0 ? c * std::log(c) : 0.0;
+      }
+
+      void update(double old_count, double new_count)
+      {
+        total += new_count - old_count;
+        sum_c_log_c += c_log_c(new_count) - c_log_c(old_count);
+
+        // avoid the accumulation of rounding errors
+        if (total == 0) sum_c_log_c = 0;
+      }
     };
 
+    // The counts of classes 0, 1, ..., num_classes - 1 are preallocated,
+    // larger classes are added as they occur
     struct shannon_diversity_generator
     {
       using indicator = shannon_diversity;
+
+      shannon_diversity_generator(int num_classes = 0) : num_classes(num_classes)
+      {}
+
       indicator operator()() const
       {
-        return indicator{};
+        return indicator(num_classes);
       }
+
+      int num_classes;
     };
   }
 }
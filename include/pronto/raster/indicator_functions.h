@@ -14,6 +14,10 @@
 #include <pronto/raster/weighted_raster_view.h>
 #include <pronto/raster/optional.h>
 
+#include <tuple>
+#include <type_traits>
+#include <utility> // std::index_sequence
+
 namespace pronto {
   namespace raster {
     /*
@@ -28,6 +32,17 @@ namespace pronto {
     template<class Raster, class IndicatorTag>
     using get_indicator_t = typename get_indicator<Raster, IndicatorTag>::type;
     */
+    // Indicators that declare themselves linear accumulators only keep the
+    // total weight and the weighted sum of their samples, and can be set
+    // from these with set_weight_and_sum. The moving windows keep the
+    // subtotals of such indicators as arrays of doubles and update these
+    // one row at a time.
+    template<class Indicator, class Value>
+    concept LinearAccumulator = requires(Indicator i) {
+      requires Indicator::is_linear_accumulator;
+      i.set_weight_and_sum(0.0, 0.0);
+    } && std::is_arithmetic_v<recursive_optional_value_type<Value> >;
+
     template<class Indicator, class Value>
     struct indicator_functions
     {
@@ -87,6 +102,92 @@ namespace pronto {
       }
     };
 
+    // Combines several indicators that take the same samples, so a single
+    // window traversal feeds all of them. The samples and subtotals are
+    // passed on to each indicator, and extract returns a tuple with the
+    // results of all indicators. To write each result to its own band,
+    // assign the extracted view to a raster_tuple of the bands.
+    template<class... Indicators>
+    struct fused_indicator
+    {
+      template<class... Args>
+      void add_sample(const Args&... args)
+      {
+        std::apply([&](auto&... i) { (i.add_sample(args...), ...); }
+          , m_indicators);
+      }
+
+      template<class... Args>
+      void subtract_sample(const Args&... args)
+      {
+        std::apply([&](auto&... i) { (i.subtract_sample(args...), ...); }
+          , m_indicators);
+      }
+
+      template<class... Args>
+      void add_subtotal(const fused_indicator& subtotal, const Args&... args)
+      {
+        for_each_pair(subtotal, [&](auto& i, const auto& s) {
+          i.add_subtotal(s, args...); });
+      }
+
+      template<class... Args>
+      void subtract_subtotal(const fused_indicator& subtotal, const Args&... args)
+      {
+        for_each_pair(subtotal, [&](auto& i, const auto& s) {
+          i.subtract_subtotal(s, args...); });
+      }
+
+      auto extract() const
+      {
+        return std::apply([](const auto&... i) {
+          return std::make_tuple(i.extract()...); }, m_indicators);
+      }
+
+      std::tuple<Indicators...> m_indicators;
+
+    private:
+      template<class F, std::size_t... I>
+      void for_each_pair(const fused_indicator& other, F&& f
+        , std::index_sequence<I...>)
+      {
+        (f(std::get<I>(m_indicators), std::get<I>(other.m_indicators)), ...);
+      }
+
+      template<class F>
+      void for_each_pair(const fused_indicator& other, F&& f)
+      {
+        for_each_pair(other, f, std::index_sequence_for<Indicators...>{});
+      }
+    };
+
+    template<class... IndicatorGenerators>
+    struct fused_generator
+    {
+      using indicator = fused_indicator<typename IndicatorGenerators::indicator...>;
+
+      fused_generator() = default;
+
+      fused_generator(const IndicatorGenerators&... generators)
+        : m_generators(generators...)
+      {}
+
+      indicator operator()() const
+      {
+        return std::apply([](const auto&... g) {
+          return indicator{ std::make_tuple(g()...) }; }, m_generators);
+      }
+
+      std::tuple<IndicatorGenerators...> m_generators;
+    };
+
+    template<class... IndicatorGenerators>
+    fused_generator<IndicatorGenerators...> fuse(
+      const IndicatorGenerators&... generators)
+    {
+      return fused_generator<IndicatorGenerators...>(generators...);
+    }
+
     //template<class IndicatorView>
     //using extracted_indicator_view = transform_raster_view<indicator_extractor,
     //  IndicatorView>;
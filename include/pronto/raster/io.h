@@ -15,6 +15,7 @@
 #pragma once
 #include <pronto/raster/assign.h>
 #include <pronto/raster/exceptions.h>
+#include <pronto/raster/gdal_data_type.h>
 #include <pronto/raster/gdal_includes.h>
 #include <pronto/raster/gdal_raster_view.h>
 #include <pronto/raster/uncasted_gdal_raster_view.h>
@@ -34,73 +35,6 @@ namespace pronto
     };
 
     namespace detail {
-      template<typename T> struct native_gdal_data_type
-      {
-        static const GDALDataType value = GDT_Unknown;
-      };
-
-      template<> struct native_gdal_data_type<int32_t>
-      {
-        static const GDALDataType value = GDT_Int32;
-      };
-
-      template<>
-      struct native_gdal_data_type<uint32_t>
-      {
-        static const GDALDataType value = GDT_UInt32;
-      };
-
-      template<> struct native_gdal_data_type<int16_t>
-      {
-        static const GDALDataType value = GDT_Int16;
-      };
-
-      template<> struct native_gdal_data_type<uint16_t>
-      {
-        static const GDALDataType value = GDT_UInt16;
-      };
-
-      template<> struct native_gdal_data_type<uint8_t>
-      {
-        static const GDALDataType value = GDT_Byte;
-      };
-
-      template<> struct native_gdal_data_type<bool>
-      {
-        static const GDALDataType value = GDT_Byte;
-      };
-
-      template<> struct native_gdal_data_type<float>
-      {
-        static const GDALDataType value = GDT_Float32;
-      };
-
-      template<> struct native_gdal_data_type<double>
-      {
-        static const GDALDataType value = GDT_Float64;
-      };
-  /*
-      template<> struct native_gdal_data_type<cint16_t>
-      {
-        static const GDALDataType value = GDT_CInt16;
-      };
-
-      template<> struct native_gdal_data_type<cint32_t>
-      {
-        static const GDALDataType value = GDT_CInt32;
-      };
-      template<> struct native_gdal_data_type<cfloat32_t>
-      {
-        static const GDALDataType value = GDT_CFloat32;
-      };
-      template<> struct native_gdal_data_type<cfloat64_t>
-      {
-        static const GDALDataType value = GDT_CFloat64;
-      };
-
-      */
-
-  
       GDALDataset* create_compressed_gdaldataset(
           const std::filesystem::path& path, int rows, int cols
           , GDALDataType datatype, int nBands = 1);
@@ -148,8 +82,6 @@ namespace pronto
           , const gdal_raster_view_base& model,
           GDALDataType datatype, is_temporary is_temp);
     } // detail
-    template<class T>
-    static const GDALDataType gdal_data_type = detail::native_gdal_data_type<T>::value;
 
     template<class T, iteration_type IterationType = iteration_type::multi_pass, access AccessType = access::read_write>
     gdal_raster_view<T, IterationType, AccessType> open(const std::filesystem::path& path,int band_index = 1)
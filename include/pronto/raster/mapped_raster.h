@@ -0,0 +1,70 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// Intermediate rasters that do not fit in memory can be stored in a
+// memory-mapped temporary file. This avoids the overhead of the GTiff
+// driver and the GDAL block cache: the cells are accessed directly through
+// pointers and the operating system pages them in and out. The file is
+// removed when the last raster referring to it is destroyed.
+//
+
+#pragma once
+
+#include <pronto/raster/memory_raster.h>
+
+#include <cstddef> // std::size_t
+#include <memory> // std::shared_ptr
+#include <type_traits>
+
+namespace pronto
+{
+  namespace raster
+  {
+    // Hint to the operating system how the cells will be accessed
+    enum class access_pattern
+    {
+      normal,
+      sequential,
+      random
+    };
+
+    namespace detail {
+      // Maps a new temporary file of the given size for reading and writing.
+      // The file is unmapped and removed when the last copy of the returned
+      // pointer is destroyed.
+      std::shared_ptr<void> map_temp_file(std::size_t bytes, access_pattern pattern);
+
+      void advise_mapped_range(void* first, std::size_t bytes, access_pattern pattern);
+    } // detail
+
+    // Cells are stored row by row and are initialized to zero.
+    template<class T>
+    memory_raster<T> create_mapped_temp(int rows, int cols
+      , access_pattern pattern = access_pattern::normal)
+    {
+      static_assert(std::is_trivially_copyable_v<T>
+        , "mapped rasters can only hold trivially copyable values");
+      const std::size_t n = static_cast<std::size_t>(rows) * cols;
+      std::shared_ptr<void> file = detail::map_temp_file(n * sizeof(T), pattern);
+      std::shared_ptr<T[]> data(file, static_cast<T*>(file.get()));
+      return memory_raster<T>(data, rows, cols);
+    }
+
+    // Changes the access hint for the rows of a mapped raster, this can be
+    // used when an algorithm switches from random to sequential access.
+    template<class T>
+    void advise(const memory_raster<T>& raster, access_pattern pattern)
+    {
+      if (raster.size() == 0) return;
+      const std::size_t bytes = sizeof(T) *
+        (static_cast<std::size_t>(raster.rows() - 1) * raster.stride() + raster.cols());
+      detail::advise_mapped_range(raster.data(), bytes, pattern);
+    }
+  }
+}
@@ -0,0 +1,218 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// The memory_raster is a RasterView on a contiguous array on the heap. It is
+// meant for intermediate results that fit in memory and do not need to be
+// written to a (temporary) file. Like the gdal_raster_view it has shallow
+// copy semantics: copies and sub-rasters refer to the same data.
+//
+
+#pragma once
+
+#include <pronto/raster/iterator_facade.h>
+
+#include <cstddef> // std::ptrdiff_t
+#include <memory> // std::shared_ptr
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+namespace pronto
+{
+  namespace raster
+  {
+    template<class T, bool IsMutable>
+    class memory_raster_iterator
+      : public iterator_facade<memory_raster_iterator<T, IsMutable> >
+    {
+    public:
+      static const bool is_mutable = IsMutable;
+      static const bool is_single_pass = false;
+
+      using pointer = std::conditional_t<IsMutable, T*, const T*>;
+      using reference = std::conditional_t<IsMutable, T&, const T&>;
+
+      memory_raster_iterator() : m_first(nullptr), m_pos(nullptr), m_col(0)
+        , m_cols(0), m_stride(0)
+      {}
+
+      memory_raster_iterator(pointer first, int cols, int stride
+        , std::ptrdiff_t index)
+        : m_first(first), m_cols(cols), m_stride(stride)
+      {
+        set_index(index);
+      }
+
+      reference dereference() const
+      {
+        return *m_pos;
+      }
+
+      void increment()
+      {
+        ++m_pos;
+        if (++m_col == m_cols) {
+          m_col = 0;
+          m_pos += m_stride - m_cols;
+        }
+      }
+
+      void decrement()
+      {
+        if (m_col == 0) {
+          m_col = m_cols;
+          m_pos -= m_stride - m_cols;
+        }
+        --m_col;
+        --m_pos;
+      }
+
+      void advance(std::ptrdiff_t n)
+      {
+        set_index(index() + n);
+      }
+
+      bool equal_to(const memory_raster_iterator& that) const
+      {
+        return m_pos == that.m_pos;
+      }
+
+      std::ptrdiff_t distance_to(const memory_raster_iterator& that) const
+      {
+        return that.index() - index();
+      }
+
+    private:
+      std::ptrdiff_t index() const
+      {
+        if (m_cols == 0) return 0;
+        const std::ptrdiff_t row = (m_pos - m_first - m_col) / m_stride;
+        return row * m_cols + m_col;
+      }
+
+      void set_index(std::ptrdiff_t index)
+      {
+        if (m_cols == 0) {
+          m_pos = m_first;
+          m_col = 0;
+          return;
+        }
+        const std::ptrdiff_t row = index / m_cols;
+        m_col = static_cast<int>(index % m_cols);
+        m_pos = m_first + row * m_stride + m_col;
+      }
+
+      pointer m_first;
+      pointer m_pos;
+      int m_col;
+      int m_cols;
+      int m_stride;
+    };
+
+    template<class T>
+    class memory_raster : public std::ranges::view_interface<memory_raster<T> >
+    {
+    public:
+      using value_type = T;
+      using iterator = memory_raster_iterator<T, true>;
+      using const_iterator = memory_raster_iterator<T, false>;
+
+      memory_raster() : m_first(nullptr), m_rows(0), m_cols(0), m_stride(0)
+      {}
+
+      // Values are value-initialized
+      memory_raster(int rows, int cols)
+        : m_data(std::make_shared<T[]>(static_cast<std::size_t>(rows) * cols))
+        , m_rows(rows), m_cols(cols), m_stride(cols)
+      {
+        m_first = m_data.get();
+      }
+
+      memory_raster(int rows, int cols, const T& value)
+        : m_data(std::make_shared<T[]>(static_cast<std::size_t>(rows) * cols, value))
+        , m_rows(rows), m_cols(cols), m_stride(cols)
+      {
+        m_first = m_data.get();
+      }
+
+      // Refers to rows x cols values that are already allocated, e.g. in a
+      // memory-mapped file (see create_mapped_temp)
+      memory_raster(std::shared_ptr<T[]> data, int rows, int cols)
+        : m_data(data), m_first(data.get()), m_rows(rows), m_cols(cols)
+        , m_stride(cols)
+      {}
+
+      int rows() const
+      {
+        return m_rows;
+      }
+
+      int cols() const
+      {
+        return m_cols;
+      }
+
+      // Computed in 64 bits, rasters in memory can exceed 2^31 cells
+      std::ptrdiff_t size() const
+      {
+        return static_cast<std::ptrdiff_t>(m_rows) * m_cols;
+      }
+
+      // Number of elements between the starts of consecutive rows
+      int stride() const
+      {
+        return m_stride;
+      }
+
+      T* data() const
+      {
+        return m_first;
+      }
+
+      iterator begin() const
+      {
+        return iterator(m_first, m_cols, m_stride, 0);
+      }
+
+      iterator end() const
+      {
+        return iterator(m_first, m_cols, m_stride, size());
+      }
+
+      memory_raster sub_raster(int first_row, int first_col, int rows, int cols) const
+      {
+        memory_raster out = *this; // shares the data
+        out.m_first = m_first + static_cast<std::ptrdiff_t>(first_row) * m_stride + first_col;
+        out.m_rows = rows;
+        out.m_cols = cols;
+        return out;
+      }
+
+      static const bool has_stretches = true;
+      static const bool has_mutable_stretches = true;
+      using stretch_type = std::span<T>;
+
+      // Each row of the raster is a single stretch
+      template<class F>
+      void for_each_stretch(F&& f) const
+      {
+        for (int row = 0; row < m_rows; ++row) {
+          f(row, 0, stretch_type(m_first + static_cast<std::ptrdiff_t>(row) * m_stride, m_cols));
+        }
+      }
+
+    private:
+      std::shared_ptr<T[]> m_data;
+      T* m_first;
+      int m_rows;
+      int m_cols;
+      int m_stride;
+    };
+  }
+}
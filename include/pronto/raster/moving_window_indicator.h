@@ -10,18 +10,36 @@
 
 #pragma once
 
+#include <pronto/raster/assign.h>
+#include <pronto/raster/block_layout.h>
 #include <pronto/raster/circular_edge_window_view.h>
 #include <pronto/raster/circular_window_view.h>
+#include <pronto/raster/multi_circular_window_view.h>
 #include <pronto/raster/patch_raster_transform.h>
+#include <pronto/raster/raster_allocator.h>
 #include <pronto/raster/rectangle_edge_window_view.h>
 #include <pronto/raster/square_window_view.h>
+#include <pronto/raster/summed_area_table.h>
 #include <pronto/raster/distance_weighted_window_view.h>
+#include <pronto/raster/exceptions.h>
+#include <pronto/raster/tile_scheduler.h>
+#include <pronto/raster/traits.h>
+#include <pronto/raster/vector_of_raster_view.h>
+#include <pronto/raster/weighted_window_convolution.h>
 
+#include <algorithm> // std::min, std::stable_sort
+#include <execution>
+#include <numeric> // std::iota
+#include <type_traits>
 #include <vector>
 
 namespace pronto {
   namespace raster {
     
+    // A concept, so overloads for specific windows subsume the generic one
+    template<class T>
+    concept ExecutionPolicyConcept = std::is_execution_policy_v<std::remove_cvref_t<T> >;
+
     struct square
     {
       square() = default;
@@ -63,7 +81,11 @@ namespace pronto {
       patch_circle(double radius) : radius(radius) {}
       double radius;
     };
-     
+
+    // Gives a lazy view that updates the indicator per cell, at a cost that
+    // grows with the radius, also for linear accumulators. The summed area
+    // table, with a cost per cell independent of the radius, is only used
+    // by the overloads with an execution policy or a summed_area_table.
     template<class Raster, class IndicatorGenerator>
     auto moving_window_indicator(const Raster& raster, const square& window
       , const IndicatorGenerator& indicator_generator)
@@ -72,6 +94,18 @@ namespace pronto {
         , indicator_generator));
     }
 
+    // Windows from the summed area table cost four lookups per cell for
+    // any radius, this requires a linear accumulator (e.g. mean or count).
+    // The full table pays off when it is shared by several radii, for a
+    // single radius the overload with an execution policy streams it.
+    template<class IndicatorGenerator>
+    auto moving_window_indicator(const summed_area_table& table, const square& window
+      , const IndicatorGenerator& indicator_generator)
+    {
+      return extract(make_summed_area_window_view(table, window.radius
+        , indicator_generator));
+    }
+
     template<class Raster, class IndicatorGenerator>
     auto moving_window_indicator(const Raster& raster, const circle& window
       , const IndicatorGenerator& indicator_generator)
@@ -81,6 +115,50 @@ namespace pronto {
     }
 
 
+    // Calculates the indicator for circular windows of several radii in a
+    // single pass over the raster. The result for each window is stored in
+    // its own raster (made by the allocator), in the order of the windows.
+    // Throws moving_window_indicator_without_windows if windows is empty.
+    template<class Raster, class IndicatorGenerator
+      , class RasterAllocator = default_raster_allocator>
+    auto moving_window_indicator(const Raster& raster
+      , const std::vector<circle>& windows
+      , const IndicatorGenerator& indicator_generator
+      , RasterAllocator allocator = RasterAllocator{})
+    {
+      if (windows.empty()) throw(moving_window_indicator_without_windows{});
+      const int n = static_cast<int>(windows.size());
+      std::vector<int> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return windows[a].radius < windows[b].radius; });
+      std::vector<double> radii;
+      for (int k : order) {
+        radii.push_back(windows[k].radius);
+      }
+
+      using value_type = decltype(indicator_generator().extract());
+      using band_type = decltype(allocator.template allocate<value_type>(0, 0));
+      std::vector<band_type> bands;
+      for (int k = 0; k < n; ++k) {
+        bands.push_back(allocator.template allocate<value_type>(raster.rows()
+          , raster.cols()));
+      }
+      std::vector<typename traits<band_type>::iterator> outputs;
+      for (int k : order) {
+        outputs.push_back(bands[k].begin());
+      }
+
+      auto view = make_multi_circular_window_view(raster, radii, indicator_generator);
+      for (auto&& indicators : view) {
+        for (int k = 0; k < n; ++k) {
+          *outputs[k] = indicators[k].extract();
+          ++outputs[k];
+        }
+      }
+      return vector_of_raster_view<band_type>(bands);
+    }
+
     template<class Raster, class IndicatorGenerator>
     auto moving_window_indicator(const Raster& raster, const edge_circle& window
       , const IndicatorGenerator& indicator_generator)
@@ -121,5 +199,133 @@ namespace pronto {
       return make_distance_weighted_indicator_view(raster, window, indicator_generator);
     }
 
+    namespace detail {
+      // The moving window iterators are single-pass: they slide a buffer of
+      // column subtotals down the raster. To use multiple threads the output
+      // is divided in bands of full rows. Each band is a sub_raster of the
+      // window view, which initializes its buffer from the rows within the
+      // radius above the band (the halo) and then slides down the band.
+      // f(sub_out, tile) is called for each band.
+      template<class RasterOut, class F>
+      void for_each_row_band(RasterOut& out, F f
+        , int num_threads = default_number_of_threads())
+      {
+        const int rows = out.rows();
+        const int cols = out.cols();
+        if (rows == 0 || cols == 0) return;
+
+        // A few bands per thread to balance the load, each band pays for
+        // initializing its halo once.
+        const int num_bands = std::min(rows, 4 * num_threads);
+        int band_rows = (rows + num_bands - 1) / num_bands;
+        int row_offset = 0;
+
+        // Bands of an output backed by blocks are aligned to the blocks, so
+        // each block is written by a single thread
+        if (const auto layout = get_block_layout(out)) {
+          band_rows = (band_rows + layout->rows - 1) / layout->rows * layout->rows;
+          row_offset = layout->row_offset;
+        }
+        const tile_grid grid(rows, cols, band_rows, cols, row_offset, 0);
+        parallel_for_each_tile(grid, [&](const tile& t, int) {
+          auto sub_out = out.sub_raster(t.first_row, t.first_col, t.rows, t.cols);
+          f(sub_out, t);
+          }, num_threads);
+      }
+
+      template<class RasterOut, class WindowView>
+      void assign_in_row_bands(RasterOut& out, const WindowView& view
+        , int num_threads = default_number_of_threads())
+      {
+        for_each_row_band(out, [&](auto& sub_out, const tile& t) {
+          assign(sub_out, view.sub_raster(t.first_row, t.first_col, t.rows, t.cols));
+          }, num_threads);
+      }
+    } // detail
+
+    // Calculates the moving window indicator for all cells and stores the
+    // result in a raster made by the allocator. Sequenced policies visit the
+    // cells in order, other policies process bands of rows on multiple
+    // threads. The window must be one of the types that does not need a
+    // contiguity argument, for patch-based windows apply patch_raster first.
+    template<class ExecutionPolicy, class Raster, class Window
+      , class IndicatorGenerator, class RasterAllocator = default_raster_allocator>
+      requires ExecutionPolicyConcept<ExecutionPolicy>
+    auto moving_window_indicator(ExecutionPolicy&&, const Raster& raster
+      , const Window& window, const IndicatorGenerator& indicator_generator
+      , RasterAllocator allocator = RasterAllocator{})
+    {
+      auto view = moving_window_indicator(raster, window, indicator_generator);
+      using value_type = typename traits<decltype(view)>::value_type;
+      auto out = allocator.template allocate<value_type>(view.rows(), view.cols());
+      if constexpr (std::is_same_v<std::remove_cvref_t<ExecutionPolicy>
+        , std::execution::sequenced_policy>) {
+        assign(out, view);
+      }
+      else {
+        detail::assign_in_row_bands(out, view);
+      }
+      return out;
+    }
+
+    // Square windows with linear accumulators (e.g. mean or count) are 
+    // calculated from a summed area table, which costs four lookups per cell
+    // for any radius. Each band of rows streams its own part of the table, 
+    // so no more than 2 * radius + 2 rows of it are held per thread.
+    template<class ExecutionPolicy, class Raster, class IndicatorGenerator
+      , class RasterAllocator = default_raster_allocator>
+      requires ExecutionPolicyConcept<ExecutionPolicy>
+        && LinearAccumulator<typename IndicatorGenerator::indicator
+          , typename traits<Raster>::value_type>
+    auto moving_window_indicator(ExecutionPolicy&&, const Raster& raster
+      , const square& window, const IndicatorGenerator& indicator_generator
+      , RasterAllocator allocator = RasterAllocator{})
+    {
+      using value_type = decltype(indicator_generator().extract());
+      auto out = allocator.template allocate<value_type>(raster.rows(), raster.cols());
+      const bool sequenced = std::is_same_v<std::remove_cvref_t<ExecutionPolicy>
+        , std::execution::sequenced_policy>;
+      detail::for_each_row_band(out, [&](auto& sub_out, const tile& t) {
+        summed_area_windows(raster, window.radius, indicator_generator, sub_out
+          , t.first_row, t.rows);
+        }, sequenced ? 1 : default_number_of_threads());
+      return out;
+    }
+
+    // Weighted windows with linear accumulators (e.g. mean) are calculated
+    // as convolutions, which do not visit the whole kernel for each cell
+    template<class ExecutionPolicy, class Raster, class IndicatorGenerator
+      , class WindowAllocator, class WeightType
+      , class RasterAllocator = default_raster_allocator>
+      requires ExecutionPolicyConcept<ExecutionPolicy>
+        && LinearAccumulator<typename IndicatorGenerator::indicator
+          , typename traits<Raster>::value_type>
+    auto moving_window_indicator(ExecutionPolicy&&, const Raster& raster
+      , const weighted_window<WindowAllocator, WeightType>& window
+      , const IndicatorGenerator& indicator_generator
+      , RasterAllocator allocator = RasterAllocator{})
+    {
+      const bool sequenced = std::is_same_v<std::remove_cvref_t<ExecutionPolicy>
+        , std::execution::sequenced_policy>;
+      return convolve_weighted_window(raster, window, indicator_generator
+        , allocator, sequenced ? 1 : default_number_of_threads());
+    }
+
+    // Gaussian and exponential windows are only calculated as convolutions,
+    // by recursive filters
+    template<class ExecutionPolicy, class Raster, class Window
+      , class IndicatorGenerator, class RasterAllocator = default_raster_allocator>
+      requires ExecutionPolicyConcept<ExecutionPolicy>
+        && (std::is_same_v<Window, gaussian_window>
+          || std::is_same_v<Window, exponential_window>)
+    auto moving_window_indicator(ExecutionPolicy&&, const Raster& raster
+      , const Window& window, const IndicatorGenerator& indicator_generator
+      , RasterAllocator allocator = RasterAllocator{})
+    {
+      const bool sequenced = std::is_same_v<std::remove_cvref_t<ExecutionPolicy>
+        , std::execution::sequenced_policy>;
+      return convolve_weighted_window(raster, window, indicator_generator
+        , allocator, sequenced ? 1 : default_number_of_threads());
+    }
   }
 }
@@ -0,0 +1,332 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// The multi_circular_window_view calculates an indicator for circular
+// windows of several radii in a single pass over the raster. Each cell
+// gives a vector with one indicator per radius. All windows read from the
+// same padded raster, and the first window of each radius is initialized
+// from the window of the next smaller radius plus the ring around it.
+//
+// Only the initialization is shared between radii. The edges of circles of
+// different radii are different cells, so each radius keeps its own edge
+// iterators (about 8 * radius + 4 of them) that each read the raster, and
+// each step updates the windows of all radii. The cost per cell, including
+// the reading of the raster, is therefore the same as for a separate 
+// circular_window_view per radius; there is no saving per cell. What is 
+// saved is the once-only initialization of the first window of the larger
+// radii, and the view gives the indicators of all radii together.
+//
+
+#pragma once
+
+#include <pronto/raster/indicator_functions.h>
+#include <pronto/raster/iterator_facade.h>
+#include <pronto/raster/optional_raster_view.h>
+#include <pronto/raster/padded_raster_view.h>
+
+#include <algorithm> // std::is_sorted, std::max
+#include <cassert>
+#include <cmath> // sqrt
+#include <vector>
+
+namespace pronto {
+  namespace raster {
+
+    template<class, class>
+    class multi_circular_window_view; // forward declaration
+
+    template<class Raster, class IndicatorGenerator>
+    class multi_circular_window_iterator
+      : public iterator_facade<multi_circular_window_iterator<Raster, IndicatorGenerator> >
+    {
+    public:
+      static const bool is_mutable = false;
+      static const bool is_single_pass = true;
+      using indicator = typename IndicatorGenerator::indicator;
+    private:
+      using view_type = multi_circular_window_view<Raster, IndicatorGenerator>;
+      using padded_view = padded_raster_view< optional_raster_view<Raster> >;
+      using sub_padded_view = typename traits<padded_view>::sub_raster;
+      using sub_padded_iterator = typename traits<sub_padded_view>::iterator;
+
+      using indicator_functions = indicator_functions<indicator,
+        typename traits<sub_padded_view>::value_type>;
+
+      // An edge of the window of one of the radii
+      struct edge_iterator
+      {
+        int radius_index;
+        sub_padded_iterator iterator;
+      };
+
+    public:
+      using value_type = std::vector<indicator>;
+      using reference = const value_type&;
+
+      reference dereference() const
+      {
+        return m_current;
+      }
+
+      void increment()
+      {
+        if (++m_col != m_view->cols()) {
+          for (auto&& i : m_add_right_iterators) {
+            indicator_functions::add(m_current[i.radius_index], *i.iterator);
+            ++i.iterator;
+          }
+          for (auto&& i : m_subtract_left_iterators) {
+            indicator_functions::subtract(m_current[i.radius_index], *i.iterator);
+            ++i.iterator;
+          }
+        }
+        else if (++m_row != m_view->rows()) {
+          m_col = 0;
+          for (auto&& i : m_add_bottom_iterators) {
+            indicator_functions::add(m_start_of_row[i.radius_index], *i.iterator);
+            ++i.iterator;
+          }
+          for (auto&& i : m_subtract_top_iterators) {
+            indicator_functions::subtract(m_start_of_row[i.radius_index], *i.iterator);
+            ++i.iterator;
+          }
+          m_current = m_start_of_row;
+        }
+        else { // end of raster
+          m_col = 0;
+          clear_iterators();
+        }
+      }
+
+      bool equal_to(const multi_circular_window_iterator& that) const
+      {
+        return that.m_row == m_row && that.m_col == m_col;
+      }
+
+    private:
+      friend class multi_circular_window_view<Raster, IndicatorGenerator>;
+
+      void find_begin(const view_type& view)
+      {
+        m_view = &view;
+        m_col = 0;
+        m_row = 0;
+        const int n = static_cast<int>(m_view->m_radii.size());
+        m_current.assign(n, m_view->m_indicator_generator());
+
+        // The window of each radius starts as the window of the previous
+        // radius, to which the ring between the two radii is added
+        for (int k = 0; k < n; ++k) {
+          if (k > 0) m_current[k] = m_current[k - 1];
+          for (auto&& i : m_view->m_ring_ranges[k]) {
+            for (auto&& j : i) {
+              indicator_functions::add(m_current[k], j);
+            }
+          }
+        }
+        m_start_of_row = m_current;
+        clear_iterators();
+
+        for (int k = 0; k < n; ++k) {
+          for (auto&& i : m_view->m_add_right_ranges[k]) {
+            m_add_right_iterators.push_back(edge_iterator{ k, i.begin() });
+          }
+          for (auto&& i : m_view->m_subtract_left_ranges[k]) {
+            m_subtract_left_iterators.push_back(edge_iterator{ k, i.begin() });
+          }
+          for (auto&& i : m_view->m_add_bottom_ranges[k]) {
+            m_add_bottom_iterators.push_back(edge_iterator{ k, i.begin() });
+          }
+          for (auto&& i : m_view->m_subtract_top_ranges[k]) {
+            m_subtract_top_iterators.push_back(edge_iterator{ k, i.begin() });
+          }
+        }
+      }
+
+      void find_end(const view_type& view)
+      {
+        m_view = &view;
+        m_col = 0;
+        m_row = m_view->rows();
+        clear_iterators();
+      }
+
+      void clear_iterators()
+      {
+        m_add_right_iterators.clear();
+        m_subtract_left_iterators.clear();
+        m_add_bottom_iterators.clear();
+        m_subtract_top_iterators.clear();
+      }
+
+      std::vector<indicator> m_start_of_row;
+      std::vector<indicator> m_current;
+
+      std::vector<edge_iterator> m_add_right_iterators;
+      std::vector<edge_iterator> m_subtract_left_iterators;
+      std::vector<edge_iterator> m_add_bottom_iterators;
+      std::vector<edge_iterator> m_subtract_top_iterators;
+
+      int m_row;
+      int m_col;
+      const view_type* m_view;
+    };
+
+    template<class Raster, class IndicatorGenerator>
+    class multi_circular_window_view
+      : public std::ranges::view_interface< multi_circular_window_view< Raster, IndicatorGenerator>>
+    {
+    private:
+      using padded_view = padded_raster_view< optional_raster_view<Raster> >;
+      using sub_padded_view = typename traits<padded_view>::sub_raster;
+      using ranges_per_radius = std::vector<std::vector<sub_padded_view> >;
+
+    public:
+      using iterator = multi_circular_window_iterator<Raster, IndicatorGenerator>;
+
+      // The radii must be in ascending order
+      multi_circular_window_view(Raster raster, const std::vector<double>& radii
+        , IndicatorGenerator indicator_generator)
+        : m_raster(raster), m_radii(radii)
+        , m_indicator_generator(indicator_generator)
+        , m_first_row(0), m_first_col(0)
+        , m_rows(raster.rows()), m_cols(raster.cols())
+      {
+        assert(std::is_sorted(m_radii.begin(), m_radii.end()));
+        init_views();
+      }
+
+      multi_circular_window_view() = default;
+
+      iterator begin() const
+      {
+        iterator i;
+        i.find_begin(*this);
+        return i;
+      }
+
+      iterator end() const
+      {
+        iterator i;
+        i.find_end(*this);
+        return i;
+      }
+
+      multi_circular_window_view sub_raster(int first_row, int first_col
+        , int rows, int cols) const
+      {
+        multi_circular_window_view out = *this;
+        out.m_first_row = m_first_row + first_row;
+        out.m_first_col = m_first_col + first_col;
+        out.m_rows = rows;
+        out.m_cols = cols;
+        assert(m_raster.rows() >= out.m_first_row + rows);
+        assert(m_raster.cols() >= out.m_first_col + cols);
+        out.init_views();
+        return out;
+      }
+
+      int rows() const
+      {
+        return m_rows;
+      }
+
+      int cols() const
+      {
+        return m_cols;
+      }
+
+      int size() const
+      {
+        return m_rows * m_cols;
+      }
+
+    private:
+      friend class multi_circular_window_iterator<Raster, IndicatorGenerator>;
+
+      void init_views()
+      {
+        const int n = static_cast<int>(m_radii.size());
+        m_ring_ranges.assign(n, {});
+        m_add_right_ranges.assign(n, {});
+        m_subtract_left_ranges.assign(n, {});
+        m_add_bottom_ranges.assign(n, {});
+        m_subtract_top_ranges.assign(n, {});
+        if (n == 0) return;
+
+        // All windows use the raster padded for the largest radius
+        const int pad_round = static_cast<int>(m_radii.back());
+        padded_view padded = pad(optionalize(m_raster), pad_round,
+          pad_round + 1, pad_round, pad_round + 1, std::nullopt);
+
+        const int row0 = pad_round + m_first_row;
+        const int col0 = pad_round + m_first_col;
+
+        for (int k = 0; k < n; ++k) {
+          const double sqr_radius = m_radii[k] * m_radii[k];
+          const int radius_round = static_cast<int>(m_radii[k]);
+
+          for (int i = -radius_round; i <= radius_round; ++i) {
+            const int j = static_cast<int>(std::sqrt(sqr_radius - i * i));
+
+            // The part of this row of the window that is not in the window
+            // of the previous radius
+            int inner_j = -1;
+            if (k > 0 && std::abs(i) <= static_cast<int>(m_radii[k - 1])) {
+              inner_j = static_cast<int>(std::sqrt(m_radii[k - 1] * m_radii[k - 1] - i * i));
+            }
+            if (inner_j < 0) {
+              m_ring_ranges[k].push_back(padded.sub_raster(row0 + i, col0 - j
+                , 1, 1 + 2 * j));
+            }
+            else if (j > inner_j) {
+              m_ring_ranges[k].push_back(padded.sub_raster(row0 + i, col0 - j
+                , 1, j - inner_j));
+              m_ring_ranges[k].push_back(padded.sub_raster(row0 + i
+                , col0 + inner_j + 1, 1, j - inner_j));
+            }
+
+            // As for the circular_window_view
+            m_add_right_ranges[k].push_back(padded.sub_raster(row0 + i
+              , col0 + j + 1, m_rows, m_cols - 1));
+            m_subtract_left_ranges[k].push_back(padded.sub_raster(row0 + i
+              , col0 - j, m_rows, m_cols - 1));
+            m_add_bottom_ranges[k].push_back(padded.sub_raster(row0 + j + 1
+              , col0 + i, m_rows, 1));
+            m_subtract_top_ranges[k].push_back(padded.sub_raster(row0 - j
+              , col0 + i, m_rows, 1));
+          }
+        }
+      }
+
+      Raster m_raster;
+      std::vector<double> m_radii;
+      IndicatorGenerator m_indicator_generator;
+      int m_first_row;
+      int m_first_col;
+      int m_rows;
+      int m_cols;
+
+      ranges_per_radius m_ring_ranges;
+      ranges_per_radius m_add_right_ranges;
+      ranges_per_radius m_subtract_left_ranges;
+      ranges_per_radius m_add_bottom_ranges;
+      ranges_per_radius m_subtract_top_ranges;
+    };
+
+    template<class Raster, class IndicatorGenerator>
+    multi_circular_window_view<Raster, IndicatorGenerator>
+      make_multi_circular_window_view(Raster raster
+        , const std::vector<double>& radii, IndicatorGenerator indicator_generator)
+    {
+      using return_type = multi_circular_window_view<Raster, IndicatorGenerator>;
+      return return_type(raster, radii, indicator_generator);
+    }
+  }
+}
@@ -20,17 +20,19 @@
 namespace pronto {
   namespace raster {
 
-    template<class>
+    // The references may be proxies or true references (e.g. of 
+    // memory_raster), the value types are therefore given separately
+    template<class References, class Values>
     class pair_proxy;
 
-    template<class R1, class R2>
-    class pair_proxy< std::pair<R1, R2> > 
+    template<class R1, class R2, class V1, class V2>
+    class pair_proxy< std::pair<R1, R2>, std::pair<V1, V2> > 
     {
     public:
       
       using reference_type = std::pair<R1, R2>;
-      using value_type_1 = typename R1::value_type;
-      using value_type_2 = typename R2::value_type;
+      using value_type_1 = V1;
+      using value_type_2 = V2;
       using value_type = std::pair< value_type_1, value_type_2>; 
       
       pair_proxy(reference_type&& r) : m_ref(std::move(r))
@@ -61,8 +63,8 @@ namespace pronto {
       using value_type_1 = std::iter_value_t<I1>;
       using value_type_2 = std::iter_value_t<I2>;
       using reference_pair = std::pair<reference_1, reference_2>;
-      using reference = put_get_proxy_reference<pair_proxy<reference_pair> >;
       using value_type = std::pair<value_type_1, value_type_2>;
+      using reference = put_get_proxy_reference<pair_proxy<reference_pair, value_type> >;
       static const bool is_mutable = false;
       static const bool is_single_pass = false;
 
@@ -91,7 +93,8 @@ namespace pronto {
       
       reference dereference() const
       {
-        return reference(pair_proxy< reference_pair>(std::pair(*m_iters.first, *m_iters.second)));
+        return reference(pair_proxy<reference_pair, value_type>(
+          reference_pair(*m_iters.first, *m_iters.second)));
       }
 
       bool equal_to(const pair_raster_iterator& b) const
@@ -8,20 +8,41 @@
 //=======================================================================
 //
 // This file contains the functions for delineating patches in the dataset. 
-// For very large datasets this can cause trouble as the algorithm creates a 
-// std::deque of cell values that can turn very large.
-// Before using a std::deque (FIFO) we used a std::stack (LIFO), std::deque 
-// keeps the stack/deque smaller and saves the day for the large CORINE dataset
+// The raster is divided in tiles that are aligned to the blocks of the input.
+// Tiles are labelled on demand: iterating over a (sub-)raster labels the 
+// tiles that it overlaps and the tiles around them that are needed to
+// complete its patches. Labelled tiles are kept, so later sub-rasters reuse
+// them.
+//
+// Each tile is labelled with a two-pass union-find algorithm that reads it
+// once in row-major order. The parts of patches in different tiles (pieces) 
+// are merged at the seams between tiles. Tiles that are needed at the same 
+// time can be labelled on multiple threads.
 //
 
 #pragma once
 
+#include <pronto/raster/block_layout.h>
+#include <pronto/raster/iterator_facade.h>
 #include <pronto/raster/optional.h>
 #include <pronto/raster/io.h>
+#include <pronto/raster/memory_raster.h>
+#include <pronto/raster/raster_allocator.h>
+#include <pronto/raster/tile_scheduler.h>
 
-#include <deque>
+#include <algorithm> // std::min, std::max, std::sort, std::unique
+#include <cmath> // std::sqrt
+#include <cstddef> // std::ptrdiff_t, std::size_t
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <type_traits>  //is_same 
+#include <unordered_set>
+#include <utility> // std::pair, std::swap
+#include <variant>
 #include <vector>
 
 
@@ -37,44 +58,750 @@ namespace pronto {
     using queen_contiguity = std::integral_constant<contiguity,contiguity::queen>;
     using rook_contiguity = std::integral_constant<contiguity, contiguity::rook>;
     
+    // Counts are 64-bit, so patches of rasters with more than 2^31 cells do 
+    // not overflow
     struct patch_info
     {
-      int m_area;
-      int m_perimeter;
+      std::int64_t m_area;
+      std::int64_t m_perimeter;
       int m_category;
     };
-  
-    struct patch_info_lookup
+
+    namespace detail {
+      // The area, perimeter and category of patches, in separate arrays
+      template<class Count>
+      struct patch_table
+      {
+        std::vector<Count> area;
+        std::vector<Count> perimeter;
+        std::vector<int> category;
+
+        std::size_t size() const
+        {
+          return category.size();
+        }
+
+        void resize(std::size_t n)
+        {
+          area.resize(n);
+          perimeter.resize(n);
+          category.resize(n);
+        }
+
+        void push_back(Count a, Count p, int c)
+        {
+          area.push_back(a);
+          perimeter.push_back(p);
+          category.push_back(c);
+        }
+
+        patch_info get(std::size_t i) const
+        {
+          return patch_info{ static_cast<std::int64_t>(area[i])
+            , static_cast<std::int64_t>(perimeter[i]), category[i] };
+        }
+      };
+
+      // Each cell of a labelled tile refers to a piece: the part of a patch 
+      // that is inside the tile.
+      template<class T, class Label>
+      struct patch_tile
+      {
+        bool labelled = false;
+        std::size_t incomplete_pieces = 0;
+        std::uint64_t offset = 0; // of the first piece in the union-find structure
+        memory_raster<Label> pieces;
+
+        // The pieces as labelled, and then the patch of each piece once the
+        // patch is complete. For rasters of which the counts do not fit in 
+        // 32 bits the complete patches are in wide_patches.
+        patch_table<std::uint32_t> patches;
+        patch_table<std::uint64_t> wide_patches;
+
+        // The values along the edges of the tile
+        std::vector<T> top;
+        std::vector<T> bottom;
+        std::vector<T> left;
+        std::vector<T> right;
+      };
+
+      // The union-find structure over the pieces of labelled tiles, the root
+      // of each patch keeps its area and perimeter. 
+      template<class Count>
+      struct patch_union_find
+      {
+        // The status of pieces, a piece is complete when all pieces of its 
+        // patch are found and its patch is written to its tile
+        static constexpr char incomplete = 0;
+        static constexpr char complete = 1;
+
+        std::vector<Count> parent;
+        patch_table<Count> info;
+        std::vector<char> status;
+
+        Count find_root(Count piece)
+        {
+          while (parent[piece] != piece) {
+            parent[piece] = parent[parent[piece]]; // path halving
+            piece = parent[piece];
+          }
+          return piece;
+        }
+
+        // Merges the patches of two pieces, the root keeps the totals
+        void unite(Count a, Count b)
+        {
+          a = find_root(a);
+          b = find_root(b);
+          if (a == b) return;
+          if (b < a) std::swap(a, b);
+          parent[b] = a;
+          info.area[a] += info.area[b];
+          info.perimeter[a] += info.perimeter[b];
+        }
+
+        // Adds the edge between the pieces to both perimeters
+        void separate(Count a, Count b)
+        {
+          ++info.perimeter[find_root(a)];
+          ++info.perimeter[find_root(b)];
+        }
+      };
+
+      // The labelling is shared by a patch_raster_transform and its 
+      // sub-rasters. Labelling happens under a mutex, but reading the 
+      // patches of cells does not. This is safe because tiles and their 
+      // pieces do not change after they are labelled, and the patch of a 
+      // piece is written once when it is complete, before any iterator can 
+      // read it.
+      //
+      // Cells are labelled per tile, so the Label type only needs to count 
+      // the pieces of a tile; tiles are made smaller when needed. The 
+      // union-find structure counts in 32 bits when the size of the raster
+      // allows it, and in 64 bits otherwise.
+      template<class Raster, contiguity Contiguity, class Label>
+      class patch_labelling
+      {
+      public:
+        using value_type = typename traits<Raster>::value_type;
+        using tile_type = patch_tile<value_type, Label>;
+
+        template<class RasterAllocator>
+        patch_labelling(Raster raster, RasterAllocator allocator, int num_threads
+          , int tile_size)
+          : m_raster(raster), m_num_threads(num_threads)
+          , m_grid(0, 0, 1, 1)
+        {
+          m_allocate = [allocator](int rows, int cols) mutable {
+            return allocator.template allocate<Label>(rows, cols);
+          };
+
+          // Tiles of at least tile_size x tile_size cells made of whole 
+          // blocks of the input, so each block is read once
+          block_layout layout = get_block_layout(raster).value_or(
+            block_layout{ 1, 1, 0, 0 });
+          m_tile_rows = (tile_size + layout.rows - 1) / layout.rows * layout.rows;
+          m_tile_cols = (tile_size + layout.cols - 1) / layout.cols * layout.cols;
+
+          // Unless the pieces of such tiles might not fit the Label type, or 
+          // their perimeters 32 bits
+          const std::uint64_t max_tile_cells = std::min<std::uint64_t>(
+            std::numeric_limits<Label>::max(), std::uint64_t{ 1 } << 30);
+          if (static_cast<std::uint64_t>(m_tile_rows) * m_tile_cols > max_tile_cells) {
+            layout = block_layout{ 1, 1, 0, 0 };
+            m_tile_rows = std::min(tile_size
+              , static_cast<int>(std::sqrt(static_cast<double>(max_tile_cells))));
+            m_tile_cols = m_tile_rows;
+          }
+          m_row_offset = layout.row_offset % m_tile_rows;
+          m_col_offset = layout.col_offset % m_tile_cols;
+          m_grid = tile_grid(raster.rows(), raster.cols(), m_tile_rows, m_tile_cols
+            , m_row_offset, m_col_offset);
+          m_major_cols = (raster.cols() + m_col_offset + m_tile_cols - 1) / m_tile_cols;
+          m_tiles = std::vector<tile_type>(m_grid.size());
+
+          // No patch has a perimeter of more than four times the number of
+          // cells
+          const std::uint64_t cells = static_cast<std::uint64_t>(raster.rows())
+            * static_cast<std::uint64_t>(raster.cols());
+          m_wide = 4 * cells > std::numeric_limits<std::uint32_t>::max();
+          if (m_wide) {
+            m_union_find = patch_union_find<std::uint64_t>{};
+          }
+        }
+
+        // Labels the tiles that are needed for the patches of the cells in
+        // the window
+        void label(int first_row, int first_col, int rows, int cols)
+        {
+          if (rows <= 0 || cols <= 0) return;
+          std::lock_guard<std::mutex> lock(m_mutex);
+          std::visit([&](auto& union_find) {
+            label(union_find, first_row, first_col, rows, cols);
+            }, m_union_find);
+        }
+
+        // Whether the complete patches are in the wide_patches of tiles
+        bool wide() const
+        {
+          return m_wide;
+        }
+
+        int major_row(int row) const
+        {
+          return (row + m_row_offset) / m_tile_rows;
+        }
+
+        int major_col(int col) const
+        {
+          return (col + m_col_offset) / m_tile_cols;
+        }
+
+        // The index of the tile that contains the cell
+        int tile_index(int row, int col) const
+        {
+          return major_row(row) * m_major_cols + major_col(col);
+        }
+
+        tile get_extent(int tile_index) const
+        {
+          return m_grid[tile_index];
+        }
+
+        const tile_type& get_tile(int tile_index) const
+        {
+          return m_tiles[tile_index];
+        }
+
+        static Label* piece_row(const tile_type& labels, int row)
+        {
+          return labels.pieces.data() 
+            + static_cast<std::ptrdiff_t>(row) * labels.pieces.stride();
+        }
+
+      private:
+        // A seam between a labelled tile and an unlabelled neighbour
+        struct frontier_edge
+        {
+          int tile;
+          int neighbour;
+          std::vector<Label> pieces; // on the edge of the labelled tile
+        };
+
+        template<class UnionFind>
+        void label(UnionFind& union_find, int first_row, int first_col
+          , int rows, int cols)
+        {
+          using count = typename decltype(union_find.parent)::value_type;
+
+          std::vector<int> window_tiles;
+          for (int i = major_row(first_row); i <= major_row(first_row + rows - 1); ++i) {
+            for (int j = major_col(first_col); j <= major_col(first_col + cols - 1); ++j) {
+              window_tiles.push_back(i * m_major_cols + j);
+            }
+          }
+          // Windows that were labelled before only cost a check per tile
+          std::erase_if(window_tiles, [&](int t) {
+            return m_tiles[t].labelled && m_tiles[t].incomplete_pieces == 0; });
+          if (window_tiles.empty()) return;
+
+          std::vector<int> batch;
+          for (int t : window_tiles) {
+            if (!m_tiles[t].labelled) batch.push_back(t);
+          }
+          label_tiles(union_find, batch);
+
+          // The pieces in the window of which the patch is not yet complete
+          std::vector<std::pair<int, Label> > pending;
+          std::unordered_set<count> seen;
+          for (int t : window_tiles) {
+            const tile_type& labels = m_tiles[t];
+            const tile extent = m_grid[t];
+            const int row_begin = std::max(first_row, extent.first_row);
+            const int row_end = std::min(first_row + rows, extent.first_row + extent.rows);
+            const int col_begin = std::max(first_col, extent.first_col);
+            const int col_end = std::min(first_col + cols, extent.first_col + extent.cols);
+            for (int r = row_begin; r < row_end; ++r) {
+              const Label* pieces = piece_row(labels, r - extent.first_row) - extent.first_col;
+              for (int c = col_begin; c < col_end; ++c) {
+                const count id = static_cast<count>(labels.offset + pieces[c]);
+                if (union_find.status[id] == union_find.incomplete
+                  && seen.insert(id).second) {
+                  pending.emplace_back(t, pieces[c]);
+                }
+              }
+            }
+          }
+          if (pending.empty()) return;
+
+          // Label the unlabelled tiles on the frontier that are touched by a
+          // pending patch, until there are no such tiles. 
+          while (true) {
+            std::unordered_set<count> roots;
+            for (auto&& [t, piece] : pending) {
+              roots.insert(union_find.find_root(static_cast<count>(m_tiles[t].offset + piece)));
+            }
+            batch.clear();
+            for (const frontier_edge& edge : m_frontier) {
+              if (touches(union_find, edge, roots)) batch.push_back(edge.neighbour);
+            }
+            std::sort(batch.begin(), batch.end());
+            batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+            if (batch.empty()) break;
+            label_tiles(union_find, batch);
+          }
+
+          // Pieces are complete once their patch is written, so a failure to
+          // label a tile leaves them to be completed by a later call
+          for (auto&& [t, piece] : pending) {
+            const count id = static_cast<count>(m_tiles[t].offset + piece);
+            const count root = union_find.find_root(id);
+            auto& patches = table_of(m_tiles[t], union_find);
+            patches.area[piece] = union_find.info.area[root];
+            patches.perimeter[piece] = union_find.info.perimeter[root];
+            union_find.status[id] = union_find.complete;
+            --m_tiles[t].incomplete_pieces;
+          }
+        }
+
+        // The table of complete patches with counts as in the union-find 
+        // structure
+        static patch_table<std::uint32_t>& table_of(tile_type& labels
+          , const patch_union_find<std::uint32_t>&)
+        {
+          return labels.patches;
+        }
+
+        static patch_table<std::uint64_t>& table_of(tile_type& labels
+          , const patch_union_find<std::uint64_t>&)
+        {
+          return labels.wide_patches;
+        }
+
+        template<class F>
+        void for_each_neighbour(int t, F&& f) const
+        {
+          const int i = t / m_major_cols;
+          const int j = t % m_major_cols;
+          const int major_rows = static_cast<int>(m_tiles.size()) / m_major_cols;
+          for (int di = -1; di <= 1; ++di) {
+            for (int dj = -1; dj <= 1; ++dj) {
+              if (di == 0 && dj == 0) continue;
+              if (Contiguity == contiguity::rook && di != 0 && dj != 0) continue;
+              if (i + di < 0 || i + di >= major_rows) continue;
+              if (j + dj < 0 || j + dj >= m_major_cols) continue;
+              f((i + di) * m_major_cols + j + dj, di, dj);
+            }
+          }
+        }
+
+        // The distinct pieces on the edge (or corner) of tile t that faces
+        // its neighbour in direction (di, dj)
+        std::vector<Label> edge_pieces(int t, int di, int dj) const
+        {
+          const tile extent = m_grid[t];
+          const int row_begin = di > 0 ? extent.rows - 1 : 0;
+          const int row_end = di < 0 ? 1 : extent.rows;
+          const int col_begin = dj > 0 ? extent.cols - 1 : 0;
+          const int col_end = dj < 0 ? 1 : extent.cols;
+          std::vector<Label> pieces;
+          for (int r = row_begin; r < row_end; ++r) {
+            for (int c = col_begin; c < col_end; ++c) {
+              pieces.push_back(piece_row(m_tiles[t], r)[c]);
+            }
+          }
+          std::sort(pieces.begin(), pieces.end());
+          pieces.erase(std::unique(pieces.begin(), pieces.end()), pieces.end());
+          return pieces;
+        }
+
+        // Whether a piece of one of the roots lies on the edge
+        template<class UnionFind, class Roots>
+        bool touches(UnionFind& union_find, const frontier_edge& edge, const Roots& roots)
+        {
+          using count = typename decltype(union_find.parent)::value_type;
+          for (Label piece : edge.pieces) {
+            const count id = static_cast<count>(m_tiles[edge.tile].offset + piece);
+            if (roots.contains(union_find.find_root(id))) return true;
+          }
+          return false;
+        }
+
+        template<class UnionFind>
+        void label_tiles(UnionFind& union_find, const std::vector<int>& batch)
+        {
+          using count = typename decltype(union_find.parent)::value_type;
+
+          if (batch.empty()) return;
+          for (int t : batch) {
+            const tile extent = m_grid[t];
+            m_tiles[t].pieces = m_allocate(extent.rows, extent.cols);
+          }
+          parallel_for_each_task(static_cast<int>(batch.size()), [&](int i, int) {
+            label_tile(m_tiles[batch[i]], m_grid[batch[i]]);
+            }, m_num_threads);
+
+          std::vector<char> in_batch(m_tiles.size(), 0);
+          for (int t : batch) {
+            tile_type& labels = m_tiles[t];
+            in_batch[t] = 1;
+            labels.offset = union_find.parent.size();
+            for (std::size_t k = 0; k < labels.patches.size(); ++k) {
+              union_find.parent.push_back(static_cast<count>(union_find.parent.size()));
+              union_find.info.push_back(labels.patches.area[k]
+                , labels.patches.perimeter[k], labels.patches.category[k]);
+              union_find.status.push_back(union_find.incomplete);
+            }
+            if (m_wide) {
+              labels.wide_patches.resize(labels.patches.size());
+              labels.wide_patches.category = labels.patches.category;
+            }
+            labels.incomplete_pieces = labels.patches.size();
+            labels.labelled = true;
+          }
+
+          // Each seam is merged once, when the second of its tiles is labelled
+          for (int t : batch) {
+            for_each_neighbour(t, [&](int n, int di, int dj) {
+              if (m_tiles[n].labelled && (!in_batch[n] || n < t)) {
+                merge(union_find, t, n, di, dj);
+              }
+              });
+          }
+
+          // The seams of the batch are no longer on the frontier, the seams 
+          // of the batch with unlabelled tiles are
+          std::erase_if(m_frontier, [&](const frontier_edge& edge) {
+            return m_tiles[edge.neighbour].labelled; });
+          for (int t : batch) {
+            for_each_neighbour(t, [&](int n, int di, int dj) {
+              if (!m_tiles[n].labelled) {
+                m_frontier.push_back(frontier_edge{ t, n, edge_pieces(t, di, dj) });
+              }
+              });
+          }
+        }
+
+        // Two-pass connected component labelling. The first pass visits the 
+        // tile row-by-row. Each cell takes the label of its neighbours 
+        // above and to the left that have the same value, labels that meet 
+        // are merged in a union-find structure. The area and perimeter are 
+        // counted per label in the same pass. The second pass replaces the
+        // labels by the pieces they belong to.
+        void label_tile(tile_type& labels, const tile& extent) const
+        {
+          const int cols = extent.cols;
+          const std::uint32_t no_label = std::numeric_limits<std::uint32_t>::max();
+
+          std::vector<std::uint32_t> parent;
+          patch_table<std::uint32_t> label_info;
+          std::vector<value_type> above(cols);
+          std::vector<value_type> current(cols);
+          labels.left.resize(extent.rows);
+          labels.right.resize(extent.rows);
+
+          auto sub = m_raster.sub_raster(extent.first_row, extent.first_col
+            , extent.rows, extent.cols);
+          auto cell = sub.begin();
+          for (int r = 0; r < extent.rows; ++r) {
+            Label* pieces = piece_row(labels, r);
+            const Label* pieces_above = r > 0 ? piece_row(labels, r - 1) : nullptr;
+            for (int c = 0; c < cols; ++c, ++cell) {
+              current[c] = *cell;
+            }
+
+            for (int c = 0; c < cols; ++c) {
+              const value_type& v = current[c];
+              std::uint32_t label = no_label;
+              auto join = [&](std::uint32_t neighbour_label) {
+                label = label == no_label ? find_root(parent, neighbour_label)
+                  : unite(parent, label, neighbour_label);
+              };
+              if (c > 0 && current[c - 1] == v) join(pieces[c - 1]);
+              if (r > 0) {
+                if (above[c] == v) join(pieces_above[c]);
+
+                // compile time IF
+                if (Contiguity == contiguity::queen) {
+                  if (c > 0 && above[c - 1] == v) join(pieces_above[c - 1]);
+                  if (c < cols - 1 && above[c + 1] == v) join(pieces_above[c + 1]);
+                }
+              }
+              if (label == no_label) {
+                label = static_cast<std::uint32_t>(parent.size());
+                parent.push_back(label);
+                label_info.push_back(0, 0, static_cast<int>(v));
+              }
+              pieces[c] = static_cast<Label>(label);
+              ++label_info.area[label];
+
+              // Each edge between different values adds to both perimeters
+              if (c > 0 && current[c - 1] != v) {
+                ++label_info.perimeter[label];
+                ++label_info.perimeter[pieces[c - 1]];
+              }
+              if (r > 0 && above[c] != v) {
+                ++label_info.perimeter[label];
+                ++label_info.perimeter[pieces_above[c]];
+              }
+            }
+            if (r == 0) labels.top = current;
+            labels.left[r] = current.front();
+            labels.right[r] = current.back();
+            std::swap(above, current);
+          }
+          labels.bottom = std::move(above);
+
+          // The parent of a label is never larger than the label itself, and 
+          // is therefore resolved first
+          const std::size_t num_labels = parent.size();
+          std::vector<Label> piece_index(num_labels);
+          patch_table<std::uint32_t>& piece_info = labels.patches;
+          piece_info = patch_table<std::uint32_t>{};
+          for (std::size_t label = 0; label < num_labels; ++label) {
+            if (parent[label] == label) {
+              piece_index[label] = static_cast<Label>(piece_info.size());
+              piece_info.push_back(label_info.area[label], label_info.perimeter[label]
+                , label_info.category[label]);
+            }
+            else {
+              const Label piece = piece_index[parent[label]];
+              piece_index[label] = piece;
+              piece_info.area[piece] += label_info.area[label];
+              piece_info.perimeter[piece] += label_info.perimeter[label];
+            }
+          }
+
+          for (int r = 0; r < extent.rows; ++r) {
+            Label* pieces = piece_row(labels, r);
+            for (int c = 0; c < cols; ++c) {
+              pieces[c] = piece_index[pieces[c]];
+            }
+          }
+        }
+
+        // The id of a piece in the union-find structure
+        template<class UnionFind>
+        auto piece_id(const UnionFind& union_find, int t, int row, int col) const
+        {
+          using count = typename decltype(union_find.parent)::value_type;
+          return static_cast<count>(m_tiles[t].offset + piece_row(m_tiles[t], row)[col]);
+        }
+
+        // Merges the pieces of tile t with those of its neighbour n in 
+        // direction (di, dj)
+        template<class UnionFind>
+        void merge(UnionFind& union_find, int t, int n, int di, int dj)
+        {
+          auto id = [&](int tile_index, int row, int col) {
+            return piece_id(union_find, tile_index, row, col);
+          };
+
+          const bool queen = Contiguity == contiguity::queen;
+          if (dj == 0) {
+            const int upper = di < 0 ? n : t;
+            const int lower = di < 0 ? t : n;
+            const auto& values_above = m_tiles[upper].bottom;
+            const auto& values_below = m_tiles[lower].top;
+            const int last = m_grid[upper].rows - 1;
+            const int cols = static_cast<int>(values_below.size());
+            for (int c = 0; c < cols; ++c) {
+              const auto below = id(lower, 0, c);
+              if (values_above[c] == values_below[c]) union_find.unite(id(upper, last, c), below);
+              else union_find.separate(id(upper, last, c), below);
+              if (queen && c > 0 && values_above[c - 1] == values_below[c]) {
+                union_find.unite(id(upper, last, c - 1), below);
+              }
+              if (queen && c < cols - 1 && values_above[c + 1] == values_below[c]) {
+                union_find.unite(id(upper, last, c + 1), below);
+              }
+            }
+          }
+          else if (di == 0) {
+            const int left = dj < 0 ? n : t;
+            const int right = dj < 0 ? t : n;
+            const auto& values_left = m_tiles[left].right;
+            const auto& values_right = m_tiles[right].left;
+            const int last = m_grid[left].cols - 1;
+            const int rows = static_cast<int>(values_right.size());
+            for (int r = 0; r < rows; ++r) {
+              const auto on_right = id(right, r, 0);
+              if (values_left[r] == values_right[r]) union_find.unite(id(left, r, last), on_right);
+              else union_find.separate(id(left, r, last), on_right);
+              if (queen && r > 0 && values_left[r - 1] == values_right[r]) {
+                union_find.unite(id(left, r - 1, last), on_right);
+              }
+              if (queen && r < rows - 1 && values_left[r + 1] == values_right[r]) {
+                union_find.unite(id(left, r + 1, last), on_right);
+              }
+            }
+          }
+          else { // diagonal neighbours only touch at a corner (queen)
+            const int upper = di < 0 ? n : t;
+            const int lower = di < 0 ? t : n;
+            const int last_row = m_grid[upper].rows - 1;
+            if ((di < 0) == (dj < 0)) { // upper-left and lower-right
+              if (m_tiles[upper].bottom.back() == m_tiles[lower].top.front()) {
+                union_find.unite(id(upper, last_row, m_grid[upper].cols - 1)
+                  , id(lower, 0, 0));
+              }
+            }
+            else { // upper-right and lower-left
+              if (m_tiles[upper].bottom.front() == m_tiles[lower].top.back()) {
+                union_find.unite(id(upper, last_row, 0)
+                  , id(lower, 0, m_grid[lower].cols - 1));
+              }
+            }
+          }
+        }
+
+        static std::uint32_t find_root(std::vector<std::uint32_t>& parent
+          , std::uint32_t label)
+        {
+          while (parent[label] != label) {
+            parent[label] = parent[parent[label]]; // path halving
+            label = parent[label];
+          }
+          return label;
+        }
+
+        // The root is the smallest label, i.e. the label first encountered 
+        static std::uint32_t unite(std::vector<std::uint32_t>& parent
+          , std::uint32_t a, std::uint32_t b)
+        {
+          a = find_root(parent, a);
+          b = find_root(parent, b);
+          if (a < b) {
+            parent[b] = a;
+            return a;
+          }
+          parent[a] = b;
+          return b;
+        }
+
+        Raster m_raster;
+        std::function<memory_raster<Label>(int, int)> m_allocate;
+        int m_num_threads;
+        int m_tile_rows;
+        int m_tile_cols;
+        int m_row_offset;
+        int m_col_offset;
+        int m_major_cols;
+        tile_grid m_grid;
+        std::vector<tile_type> m_tiles;
+        std::vector<frontier_edge> m_frontier;
+        bool m_wide;
+
+        std::mutex m_mutex;
+        std::variant<patch_union_find<std::uint32_t>
+          , patch_union_find<std::uint64_t> > m_union_find;
+      };
+    } // detail
+
+    template<class Raster, contiguity Contiguity, class Label>
+    class patch_raster_iterator
+      : public iterator_facade<patch_raster_iterator<Raster, Contiguity, Label> >
     {
-      patch_info_lookup() = default;
-      patch_info_lookup(const patch_info_lookup&) = default;
-      patch_info_lookup(patch_info_lookup&&) = default;
-      patch_info_lookup& operator=(const patch_info_lookup&) = default;
-      patch_info_lookup& operator=(patch_info_lookup&&) = default;
-
-      patch_info_lookup(std::shared_ptr<std::vector<patch_info> > patch_info)
-        : m_patch_info(patch_info)
-      {}
-    
-      std::optional<patch_info> operator()(int index) const
+      using labelling = detail::patch_labelling<Raster, Contiguity, Label>;
+
+    public:
+      static const bool is_mutable = false;
+      static const bool is_single_pass = false;
+      using value_type = std::optional<patch_info>;
+
+      patch_raster_iterator() = default;
+
+      // Iterators that are not labelled label their (sub-)raster when they
+      // first move to a cell
+      patch_raster_iterator(labelling* labels, int first_row, int first_col
+        , int cols, std::ptrdiff_t size, std::ptrdiff_t index, bool labelled)
+        : m_labelling(labels), m_first_row(first_row), m_first_col(first_col)
+        , m_cols(cols), m_size(size), m_index(index), m_labelled(labelled)
       {
-        if(index  != -1){
-          return (*m_patch_info)[index];
-        } else{
-          return std::nullopt;
+        seek();
+      }
+
+      value_type dereference() const
+      {
+        return m_labelling->wide() ? m_tile->wide_patches.get(*m_piece)
+          : m_tile->patches.get(*m_piece);
+      }
+
+      void increment()
+      {
+        ++m_index;
+        if (++m_col == m_end_col) {
+          seek();
+        }
+        else {
+          ++m_piece;
         }
       }
-  
+
+      void decrement()
+      {
+        --m_index;
+        seek();
+      }
+
+      void advance(std::ptrdiff_t n)
+      {
+        m_index += n;
+        seek();
+      }
+
+      bool equal_to(const patch_raster_iterator& that) const
+      {
+        return m_index == that.m_index;
+      }
+
+      std::ptrdiff_t distance_to(const patch_raster_iterator& that) const
+      {
+        return that.m_index - m_index;
+      }
+
     private:
-      std::shared_ptr<std::vector<patch_info> > m_patch_info;
+      // Finds the tile of the current cell, m_end_col is where the cell 
+      // leaves the tile or the row
+      void seek()
+      {
+        if (m_index < 0 || m_index >= m_size) return;
+        if (!m_labelled) {
+          m_labelling->label(m_first_row, m_first_col
+            , static_cast<int>(m_size / m_cols), m_cols);
+          m_labelled = true;
+        }
+        const int row = m_first_row + static_cast<int>(m_index / m_cols);
+        m_col = m_first_col + static_cast<int>(m_index % m_cols);
+        const int t = m_labelling->tile_index(row, m_col);
+        const tile extent = m_labelling->get_extent(t);
+        m_tile = &m_labelling->get_tile(t);
+        m_piece = labelling::piece_row(*m_tile, row - extent.first_row)
+          + (m_col - extent.first_col);
+        m_end_col = std::min(extent.first_col + extent.cols, m_first_col + m_cols);
+      }
+
+      labelling* m_labelling = nullptr;
+      int m_first_row = 0;
+      int m_first_col = 0;
+      int m_cols = 0;
+      std::ptrdiff_t m_size = 0;
+      std::ptrdiff_t m_index = 0;
+      bool m_labelled = false;
+
+      int m_col = 0;
+      int m_end_col = 0;
+      const typename labelling::tile_type* m_tile = nullptr;
+      const Label* m_piece = nullptr;
     };
 
-    template<class Raster, contiguity Contiguity>
+    // Label is the type in which cells refer to the pieces of a tile, with 
+    // std::uint16_t tiles have at most 65535 cells.
+    template<class Raster, contiguity Contiguity, class Label = std::uint32_t>
     class patch_raster_transform
     {
-      using full_patch_info_raster = transform_raster_view<patch_info_lookup, gdal_raster_view<int> >;
-      using patch_info_raster = typename traits<full_patch_info_raster>::sub_raster;
- 
+      using labelling = detail::patch_labelling<Raster, Contiguity, Label>;
+
     public:
       patch_raster_transform() = default;
       patch_raster_transform(const patch_raster_transform&) = default;
@@ -82,35 +809,44 @@ namespace pronto {
       patch_raster_transform& operator=(patch_raster_transform&&) = default;
       patch_raster_transform& operator=(const patch_raster_transform&) = default;
     
-      patch_raster_transform(Raster raster) 
-        : m_raster(raster)
-        , m_rows(raster.rows())
-        , m_cols(raster.cols())
+      patch_raster_transform(Raster raster)
+        : patch_raster_transform(raster, memory_raster_allocator{})
+      {}
+
+      // The allocator is used for the labels of tiles, which must be 
+      // memory_rasters. Use the mapped_raster_allocator for large rasters.
+      // With more than one thread, tiles are labelled in parallel. Reading 
+      // from the raster must then be safe from multiple threads. Tiles are 
+      // at least tile_size x tile_size cells, rounded up to whole blocks; 
+      // smaller tiles suit small sub-rasters of large rasters.
+      template<class RasterAllocator>
+      patch_raster_transform(Raster raster, RasterAllocator allocator
+        , int num_threads = 1, int tile_size = 512)
+        : m_labelling(std::make_shared<labelling>(raster, allocator, num_threads
+          , tile_size))
         , m_first_row(0)
         , m_first_col(0)
-        , m_index_raster_initialized(false)
-        , m_patch_raster_initialized(false)
-      {
-        create_index_raster();
-
-        m_patch_info = std::make_shared<std::vector<patch_info> >();
-        auto full = transform(patch_info_lookup(m_patch_info), m_index);
-        m_patch_info_raster = full.sub_raster(m_first_row, m_first_col, m_rows, 
-          m_cols);
-      }
+        , m_rows(raster.rows())
+        , m_cols(raster.cols())
+      {}
  
-      using iterator = typename traits<patch_info_raster>::const_iterator;
+      using iterator = patch_raster_iterator<Raster, Contiguity, Label>;
     
+      // Labels the patches in the (sub-)raster, if not already done
       iterator begin() const
       {
-        initialize();
-        return m_patch_info_raster.begin();
+        m_labelling->label(m_first_row, m_first_col, m_rows, m_cols);
+        return iterator(m_labelling.get(), m_first_row, m_first_col, m_cols
+          , size(), 0, true);
       }
     
+      // Iterators moved back from the end label the (sub-)raster then
       iterator end() const
       {
-        return m_patch_info_raster.end();
+        return iterator(m_labelling.get(), m_first_row, m_first_col, m_cols
+          , size(), size(), false);
       }
+
       int cols() const
       {
         return m_cols;
@@ -121,18 +857,15 @@ namespace pronto {
         return m_rows;
       }
 
+      std::ptrdiff_t size() const
+      {
+        return static_cast<std::ptrdiff_t>(m_rows) * m_cols;
+      }
+
       patch_raster_transform sub_raster(int first_row, int first_col, 
         int rows, int cols) const
       {
-        auto out = patch_raster_transform();
-        out.m_raster = m_raster;
-        out.m_index = m_index;
-        out.m_patch_info = m_patch_info;
-        assert(m_index_raster_initialized);
-        out.m_index_raster_initialized = m_index_raster_initialized;
-        out.m_patch_raster_initialized = m_patch_raster_initialized;
-        out.m_patch_info_raster = m_patch_info_raster.sub_raster(first_row, first_col, 
-          rows, cols);
+        patch_raster_transform out = *this;
         out.m_first_row = m_first_row + first_row;
         out.m_first_col = m_first_col + first_col;
         out.m_rows = rows;
@@ -141,133 +874,7 @@ namespace pronto {
       }
 
     private:
-      using coordinate = std::pair<int, int>;
-
-      static coordinate add(const coordinate& a, const coordinate& b ) 
-      {
-          return coordinate(a.first + b.first, a.second + b.second);
-      }
-
-      // returns the index in the full raster, not subraster
-      int index(const coordinate& c) const
-      {
-        return c.first * m_raster.cols() + c.second; 
-      }
-
-      void create_index_raster()
-      {
-        m_index = create_temp<int>(m_raster.rows(), m_raster.cols());
-
-        if (!m_index_raster_initialized) {
-          m_index_raster_initialized = true;
-          int nodata = -1;
-          for (auto&& i : m_index) {
-            i = nodata;
-          }
-        }
-      }
-      void initialize() const
-      {
-        if (m_patch_raster_initialized) return;
-
-        m_patch_raster_initialized = true;
-        int nodata = -1;
-        std::deque<coordinate> cell_stack;
-
-        static const coordinate N(-1, 0);
-        static const coordinate S(1, 0);
-        static const coordinate E(0, 1);
-        static const coordinate W(0, -1);
-        static const coordinate NW(-1, -1);
-        static const coordinate NE(-1, 1);
-        static const coordinate SW(1, -1);
-        static const coordinate SE(1, 1);
-
-        auto index_begin = m_index.begin();
-        auto raster_begin = m_raster.begin();
-        for (int i = m_first_row; i < m_first_row + m_rows; i++) {
-          for (int j = m_first_col; j < m_first_col + m_cols; j++) {
-            const coordinate coord(i, j);
-            auto index_coord = index(coord);
-            if (index_begin[index_coord] == nodata) {
-
-              int this_val = raster_begin[index_coord];
-              int this_area = 1;
-              int this_perim = 0;
-              int this_index = static_cast<int>(m_patch_info->size());
-
-              index_begin[index_coord] = static_cast<int>(m_patch_info->size());
-              cell_stack.push_back(coord);
-
-              coordinate nb;
-
-              auto rook_lambda = [&]()
-              {
-                auto index_nb = index(nb);
-                if (raster_begin[index_nb] != this_val) {
-                  ++this_perim;
-                }
-                else if (index_begin[index_nb] == nodata) {
-                  cell_stack.push_back(nb);
-                  ++this_area;
-                  index_begin[index_nb] = this_index;
-                }
-              };
-
-              auto queen_lambda = [&]()
-              {
-                auto index_nb = index(nb);
-                if (raster_begin[index_nb] == this_val
-                  && index_begin[index_nb] == nodata) {
-                  cell_stack.push_back(nb);
-                  ++this_area;
-                  index_begin[index_nb] = this_index;
-                }
-              };
-
-              while (!cell_stack.empty()) {
-                coordinate curr = cell_stack.front();
-                cell_stack.pop_front();
-
-                nb = add(curr, N); if (nb.first >= 0) rook_lambda();
-                nb = add(curr, S); if (nb.first <= m_raster.rows() - 1) 
-                  rook_lambda();
-                nb = add(curr, W); if (nb.second >= 0) rook_lambda();
-                nb = add(curr, E); if (nb.second <= m_raster.cols() - 1) 
-                  rook_lambda();
-
-                // compile time IF
-                if (Contiguity == contiguity::queen) {
-                  nb = add(curr, NW); if (nb.first >= 0 && nb.second >= 0) 
-                    queen_lambda();
-                  nb = add(curr, NE); if (nb.first >= 0 && nb.second <= 
-                    m_raster.cols() - 1) queen_lambda();
-                  nb = add(curr, SW); if (nb.first <= m_raster.rows() - 1 && 
-                    nb.second >= 0) queen_lambda();
-                  nb = add(curr, SE); if (nb.first <= m_raster.rows() - 1 && 
-                    nb.second <= m_raster.cols() - 1) queen_lambda();
-                }
-              } // while
-
-              patch_info patch;
-              patch.m_area = this_area;
-              patch.m_perimeter = this_perim;;
-              patch.m_category = this_val;
-
-              m_patch_info->push_back(patch);
-            } // if
-          } // j
-        } //i
-      }
-    
-      Raster m_raster;
-      mutable gdal_raster_view<int> m_index; 
-
-      // must be declared before m_patch_info_raster
-      mutable std::shared_ptr< std::vector<patch_info> > m_patch_info; 
-      mutable bool m_index_raster_initialized;
-      mutable bool m_patch_raster_initialized;
-      mutable patch_info_raster m_patch_info_raster;
+      std::shared_ptr<labelling> m_labelling;
       int m_first_row;
       int m_first_col;
       int m_rows;
@@ -279,5 +886,22 @@ namespace pronto {
     {
           return patch_raster_transform<Raster, Contiguity::value>(r);
     }
+
+    template<class Raster, class Contiguity, class RasterAllocator>
+    patch_raster_transform<Raster, Contiguity::value> patch_raster(Raster r, Contiguity
+      , RasterAllocator allocator)
+    {
+      return patch_raster_transform<Raster, Contiguity::value>(r, allocator);
+    }
+
+    // Use patch_raster<std::uint16_t>(...) for labels of 16 bits
+    template<class Label = std::uint32_t, class Raster, class Contiguity
+      , class RasterAllocator>
+    patch_raster_transform<Raster, Contiguity::value, Label> patch_raster(Raster r
+      , Contiguity, RasterAllocator allocator, int num_threads, int tile_size = 512)
+    {
+      return patch_raster_transform<Raster, Contiguity::value, Label>(r, allocator
+        , num_threads, tile_size);
+    }
   }  
 }
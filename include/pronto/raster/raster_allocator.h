@@ -11,6 +11,8 @@
 #pragma once
 
 #include <pronto/raster/io.h>
+#include <pronto/raster/mapped_raster.h>
+#include <pronto/raster/memory_raster.h>
 
 namespace pronto
 {
@@ -29,6 +31,41 @@ namespace pronto
       }
     };
 
-    using default_raster_allocator = gdal_raster_view_allocator;
+    class memory_raster_allocator
+    {
+    public:
+      template<class T>
+      using type = memory_raster<T>;
+
+      template<class T>
+      memory_raster<T> allocate(int rows, int cols)
+      {
+        return memory_raster<T>(rows, cols);
+      }
+    };
+
+    // For intermediate rasters that are too large to keep in memory
+    class mapped_raster_allocator
+    {
+    public:
+      mapped_raster_allocator(access_pattern pattern = access_pattern::normal)
+        : m_pattern(pattern)
+      {}
+
+      template<class T>
+      using type = memory_raster<T>;
+
+      template<class T>
+      memory_raster<T> allocate(int rows, int cols)
+      {
+        return create_mapped_temp<T>(rows, cols, m_pattern);
+      }
+    private:
+      access_pattern m_pattern;
+    };
+
+    // Intermediate rasters are kept in memory, use the
+    // mapped_raster_allocator for rasters that do not fit in memory
+    using default_raster_allocator = memory_raster_allocator;
   }
 }
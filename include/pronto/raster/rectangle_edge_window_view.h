@@ -88,16 +88,17 @@ namespace pronto {
       rectangle_edge_window_view(const Raster& raster
         , int rows_before, int rows_after, int cols_before, int cols_after
         , IndicatorGenerator indicator_generator)
-        : m_indicator_generator(indicator_generator)
-      {
-        m_h_edges = pad(optionalize(h_edge(raster)), 0, 1, 0, 0, std::nullopt);
-        m_v_edges = pad(optionalize(v_edge(raster)), 0, 0, 0, 1, std::nullopt);
-        m_h_window = single_window_view(m_h_edges, rows_before, rows_after - 1
-          , cols_before, cols_after, m_indicator_generator);
-        m_v_window = single_window_view(m_v_edges, rows_before, rows_after
-          , cols_before, cols_after - 1, m_indicator_generator);
-        m_combined = transform(indicator_joiner{}, m_h_window, m_v_window);
-      }
+        // members are initialized here, because indicator generators need
+        // not be default-constructible
+        : m_h_edges(pad(optionalize(h_edge(raster)), 0, 1, 0, 0, std::nullopt))
+        , m_v_edges(pad(optionalize(v_edge(raster)), 0, 0, 0, 1, std::nullopt))
+        , m_h_window(m_h_edges, rows_before, rows_after - 1
+          , cols_before, cols_after, indicator_generator)
+        , m_v_window(m_v_edges, rows_before, rows_after
+          , cols_before, cols_after - 1, indicator_generator)
+        , m_combined(transform(indicator_joiner{}, m_h_window, m_v_window))
+        , m_indicator_generator(indicator_generator)
+      {}
 
       // the four intermediate rasters are not necessary to keep, but leaving 
       // it now for debugging
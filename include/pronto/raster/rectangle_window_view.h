@@ -18,6 +18,7 @@
 #include <pronto/raster/optional.h>
 #include <pronto/raster/traits.h>
 
+#include <cstddef> // std::size_t
 #include <iterator>
 #include <vector>
 
@@ -26,6 +27,30 @@ namespace pronto {
    
     template<class, class > class rectangle_window_view; // forward declaration
 
+    namespace detail {
+      // Adds factor times a row of weights and sums to the column subtotals
+      inline void update_linear_subtotals(double* weights, double* sums
+        , const double* row_weights, const double* row_sums, int n
+        , double factor = 1.0)
+      {
+        for (int c = 0; c < n; ++c) {
+          weights[c] += factor * row_weights[c];
+          sums[c] += factor * row_sums[c];
+        }
+      }
+
+      // Adds the entering row and subtracts the leaving row in one pass
+      inline void update_linear_subtotals(double* weights, double* sums
+        , const double* enter_weights, const double* enter_sums
+        , const double* leave_weights, const double* leave_sums, int n)
+      {
+        for (int c = 0; c < n; ++c) {
+          weights[c] += enter_weights[c] - leave_weights[c];
+          sums[c] += enter_sums[c] - leave_sums[c];
+        }
+      }
+    } // detail
+
     template<typename Raster, typename IndicatorGenerator>
     class rectangle_window_iterator : public iterator_facade< rectangle_window_iterator<Raster, IndicatorGenerator> >
     {
@@ -51,6 +76,12 @@ namespace pronto {
         typename traits<Raster>::value_type>;
       using rectangle_window_view = rectangle_window_view<Raster, IndicatorGenerator>;
 
+      // Linear accumulators keep the column subtotals as a structure of 
+      // arrays, so a whole row of subtotals is updated in a loop over 
+      // contiguous doubles that the compiler can vectorize.
+      static const bool is_linear = LinearAccumulator<indicator,
+        typename traits<Raster>::value_type>;
+
     public:
       using value_type = indicator;
       using reference = const value_type&;
@@ -113,8 +144,6 @@ namespace pronto {
 
         int buffersize = end_col - first_col;
 
-        m_buffer.assign(buffersize, m_view->m_indicator_generator());
-        
         auto frame = m_view->m_raster.sub_raster(
           first_row, first_col
           , end_row - first_row
@@ -122,6 +151,23 @@ namespace pronto {
 
         auto iframe = frame.begin();
 
+        if constexpr (is_linear) {
+          m_weights.assign(buffersize, 0.0);
+          m_sums.assign(buffersize, 0.0);
+          m_enter_weights.resize(buffersize);
+          m_enter_sums.resize(buffersize);
+          m_leave_weights.resize(buffersize);
+          m_leave_sums.resize(buffersize);
+          for (int r = first_row; r < end_row; ++r) {
+            gather_row(iframe, m_enter_weights, m_enter_sums);
+            detail::update_linear_subtotals(m_weights.data(), m_sums.data()
+              , m_enter_weights.data(), m_enter_sums.data(), buffersize);
+          }
+          return;
+        }
+
+        m_buffer.assign(buffersize, m_view->m_indicator_generator());
+
         for (int r = first_row; r < end_row; ++r) {
           auto ib = m_buffer.begin();
           for (int c = first_col; c < end_col; ++c, ++ib, ++iframe)  {
@@ -152,12 +198,24 @@ namespace pronto {
         int end_col = std::min<int>(m_view->m_raster.cols(), 
           m_view->m_first_col + m_view->m_cols_after + 1);
         
-        int n = std::min(leading_cols + m_view->m_cols_after + 1, 
-          static_cast<int>(m_buffer.size()));
+        int buffersize = static_cast<int>(is_linear ? m_weights.size()
+          : m_buffer.size());
+        int n = std::min(leading_cols + m_view->m_cols_after + 1, buffersize);
         
-        auto ib = m_buffer.begin();
-        for (int i = 0; i < n; ++i, ++ib) {
-          m_indicator.add_subtotal(*ib);
+        if constexpr (is_linear) {
+          m_weight = 0;
+          m_sum = 0;
+          for (int i = 0; i < n; ++i) {
+            m_weight += m_weights[i];
+            m_sum += m_sums[i];
+          }
+          m_indicator.set_weight_and_sum(m_weight, m_sum);
+        }
+        else {
+          auto ib = m_buffer.begin();
+          for (int i = 0; i < n; ++i, ++ib) {
+            m_indicator.add_subtotal(*ib);
+          }
         }
         
         m_countdown_subtract_col = m_view->m_cols_before - leading_cols;
@@ -180,10 +238,17 @@ namespace pronto {
         else {
           --m_countdown_subtract_col;
         }
+        if constexpr (is_linear) {
+          m_indicator.set_weight_and_sum(m_weight, m_sum);
+        }
       }
 
       void move_row()
       {
+        if constexpr (is_linear) {
+          move_row_linear();
+          return;
+        }
         if (m_countdown_add_row > 0) {
           add_row();
           --m_countdown_add_row;
@@ -199,15 +264,79 @@ namespace pronto {
   
       void add_col()
       {
+        if constexpr (is_linear) {
+          m_weight += m_weights[m_add_col_index];
+          m_sum += m_sums[m_add_col_index];
+        }
+        else {
           m_indicator.add_subtotal(m_buffer[m_add_col_index]);
-          ++m_add_col_index;
+        }
+        ++m_add_col_index;
       }
 
       void subtract_col()
       {
-        m_indicator.subtract_subtotal(m_buffer[m_subtract_col_index]);
+        if constexpr (is_linear) {
+          m_weight -= m_weights[m_subtract_col_index];
+          m_sum -= m_sums[m_subtract_col_index];
+        }
+        else {
+          m_indicator.subtract_subtotal(m_buffer[m_subtract_col_index]);
+        }
         ++m_subtract_col_index;
       }
+
+      // Reads a row of samples as weights (1 or 0 for nodata) and values
+      template<class Iterator>
+      static void gather_row(Iterator& i, std::vector<double>& weights
+        , std::vector<double>& sums)
+      {
+        const std::size_t n = weights.size();
+        for (std::size_t c = 0; c < n; ++c, ++i) {
+          const auto& v = *i;
+          if (recursive_is_initialized(v)) {
+            weights[c] = 1.0;
+            sums[c] = static_cast<double>(recursive_get_value(v));
+          }
+          else {
+            weights[c] = 0.0;
+            sums[c] = 0.0;
+          }
+        }
+      }
+
+      // The row entering and the row leaving the window are first read into
+      // contiguous arrays, then all subtotals are updated in one loop
+      void move_row_linear()
+      {
+        const bool enter = m_countdown_add_row > 0;
+        const bool leave = m_countdown_subtract_row == 0;
+        if (enter) {
+          gather_row(m_add_row_iterator, m_enter_weights, m_enter_sums);
+          --m_countdown_add_row;
+        }
+        if (leave) {
+          gather_row(m_subtract_row_iterator, m_leave_weights, m_leave_sums);
+        }
+        else {
+          --m_countdown_subtract_row;
+        }
+        const int n = static_cast<int>(m_weights.size());
+        if (enter && leave) {
+          detail::update_linear_subtotals(m_weights.data(), m_sums.data()
+            , m_enter_weights.data(), m_enter_sums.data()
+            , m_leave_weights.data(), m_leave_sums.data(), n);
+        }
+        else if (enter) {
+          detail::update_linear_subtotals(m_weights.data(), m_sums.data()
+            , m_enter_weights.data(), m_enter_sums.data(), n);
+        }
+        else if (leave) {
+          detail::update_linear_subtotals(m_weights.data(), m_sums.data()
+            , m_leave_weights.data(), m_leave_sums.data(), n, -1.0);
+        }
+        begin_cell();
+      }
       
       void add_row()
       {
@@ -248,6 +377,16 @@ namespace pronto {
       // Stores one indicator for each column, may be problematic for large 
       // indicators / rasters
       std::vector<indicator> m_buffer;
+
+      // Used instead of m_buffer for linear accumulators
+      std::vector<double> m_weights;
+      std::vector<double> m_sums;
+      std::vector<double> m_enter_weights;
+      std::vector<double> m_enter_sums;
+      std::vector<double> m_leave_weights;
+      std::vector<double> m_leave_sums;
+      double m_weight = 0;
+      double m_sum = 0;
     };
 
     template<class Raster, class IndicatorGenerator>
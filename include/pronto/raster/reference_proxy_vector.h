@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cassert>
 #include <iostream>
 #include <vector>
 
@@ -86,7 +87,7 @@ namespace pronto {
 
       reference_proxy_vector& operator=(proxied_vector_type&& that)
       {
-        m_vector.resize(that.size());
+        assert(that.size() == m_vector.size());
         auto a = m_vector.begin();
         auto b = that.begin();
         auto b_end = that.end();
@@ -0,0 +1,98 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// A stretch is a sequence of cells on one row of a raster that is
+// contiguous in memory. Rasters that can provide stretches implement
+// for_each_stretch(f), which calls f(row, col, span) for each stretch in
+// row-major order. This allows kernels to run tight loops over spans
+// instead of going through the raster iterators cell-by-cell.
+//
+
+#pragma once
+
+#include <pronto/raster/raster.h>
+
+#include <algorithm> // std::min, std::copy
+#include <memory> // std::unique_ptr
+#include <ranges>
+#include <span>
+
+namespace pronto
+{
+  namespace raster
+  {
+    template <class R>
+    concept StretchRasterConcept = RasterConcept<R> && requires {
+      R::has_stretches;
+    } && R::has_stretches;
+
+    template <class R>
+    concept MutableStretchRasterConcept = StretchRasterConcept<R> && requires {
+      R::has_mutable_stretches;
+    } && R::has_mutable_stretches;
+
+    namespace detail {
+      // Visits the parts of the rows of a (sub)raster that fall within
+      // a single block, in row-major order.
+      // f(row, col, major_row, major_col, minor_row, minor_col, n)
+      template<class F>
+      void for_each_block_stretch(int first_row, int first_col, int rows
+        , int cols, int block_rows, int block_cols, F&& f)
+      {
+        for (int row = 0; row < rows; ++row) {
+          const int gdaldata_row = first_row + row;
+          const int major_row = gdaldata_row / block_rows;
+          const int minor_row = gdaldata_row % block_rows;
+          for (int col = 0; col < cols; ) {
+            const int gdaldata_col = first_col + col;
+            const int major_col = gdaldata_col / block_cols;
+            const int minor_col = gdaldata_col % block_cols;
+            const int n = std::min<int>(block_cols - minor_col, cols - col);
+            f(row, col, major_row, major_col, minor_row, minor_col, n);
+            col += n;
+          }
+        }
+      }
+    } // detail
+
+    // Copies the values of one row of the raster to out, which must have
+    // room for raster.cols() values.
+    template<StretchRasterConcept Raster, class T>
+    void read_row(const Raster& raster, int row, T* out)
+    {
+      auto row_raster = raster.sub_raster(row, 0, 1, raster.cols());
+      row_raster.for_each_stretch([out](int, int col, auto stretch) {
+        std::copy(stretch.begin(), stretch.end(), out + col);
+        });
+    }
+
+    // For rasters that cannot provide stretches, rows are buffered. The
+    // spans that are passed to f are then read-only copies.
+    template<RasterConcept Raster, class F>
+    void for_each_stretch(const Raster& raster, F&& f)
+    {
+      if constexpr (StretchRasterConcept<Raster>) {
+        raster.for_each_stretch(std::forward<F>(f));
+      }
+      else {
+        using value_type = std::ranges::range_value_t<Raster>;
+        const int rows = raster.rows();
+        const int cols = raster.cols();
+        auto buffer = std::make_unique<value_type[]>(cols);
+        auto i = raster.begin();
+        for (int row = 0; row < rows; ++row) {
+          for (int col = 0; col < cols; ++col, ++i) {
+            buffer[col] = static_cast<value_type>(*i);
+          }
+          f(row, 0, std::span<const value_type>(buffer.get(), cols));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,414 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// A summed_area_table holds for each cell the number of samples and the sum
+// of the samples above and to the left of it (the integral image). The
+// weight and sum of any rectangle then follow from four lookups. For
+// indicators that are linear accumulators (e.g. mean and count) this gives
+// moving windows of which the cost per cell does not depend on the radius,
+// and one table can be used for windows of all radii.
+//
+// The table is built in a single pass over the input, one row at a time, and
+// stored in rasters made by a raster allocator. Use the mapped_raster_allocator
+// for inputs of which the table does not fit in memory. Weights are counted
+// in 64-bit integers, and sums are kept with their rounding errors, so the 
+// difference of four lookups has the precision of the samples in the window,
+// not of the (much larger) sums of the table.
+//
+// To calculate windows of a single radius, summed_area_windows streams the
+// table in bands of rows and never holds more than 2 * radius + 2 rows of it.
+//
+
+#pragma once
+
+#include <pronto/raster/indicator_functions.h>
+#include <pronto/raster/iterator_facade.h>
+#include <pronto/raster/memory_raster.h>
+#include <pronto/raster/optional.h>
+#include <pronto/raster/raster_allocator.h>
+
+#include <algorithm> // std::min, std::max
+#include <cmath> // std::abs
+#include <cstddef> // std::ptrdiff_t
+#include <cstdint>
+#include <ranges>
+#include <type_traits>
+#include <utility> // std::pair
+#include <vector>
+
+namespace pronto
+{
+  namespace raster
+  {
+    namespace detail {
+      // A sum that also keeps the rounding errors of its additions (Neumaier)
+      struct compensated_sum
+      {
+        double sum = 0;
+        double error = 0;
+
+        void add(double x)
+        {
+          const double s = sum + x;
+          if (std::abs(sum) >= std::abs(x)) error += (sum - s) + x;
+          else error += (x - s) + sum;
+          sum = s;
+        }
+
+        void add(const compensated_sum& x)
+        {
+          add(x.sum);
+          error += x.error;
+        }
+      };
+
+      // One row of a summed area table, cols + 1 cells of which the first is
+      // zero
+      struct summed_area_row
+      {
+        std::int64_t* weights;
+        double* sums;
+        double* errors;
+      };
+
+      // Sets row to the row above plus the prefix sums of the samples.
+      template<class Iterator>
+      Iterator add_summed_area_row(Iterator i, int cols
+        , const summed_area_row& above, const summed_area_row& row)
+      {
+        std::int64_t row_weight = 0;
+        compensated_sum row_sum;
+        row.weights[0] = 0;
+        row.sums[0] = 0;
+        row.errors[0] = 0;
+        for (int c = 0; c < cols; ++c, ++i) {
+          const auto& v = *i;
+          if (recursive_is_initialized(v)) {
+            ++row_weight;
+            row_sum.add(static_cast<double>(recursive_get_value(v)));
+          }
+          compensated_sum total{ above.sums[c + 1], above.errors[c + 1] };
+          total.add(row_sum);
+          row.weights[c + 1] = above.weights[c + 1] + row_weight;
+          row.sums[c + 1] = total.sum;
+          row.errors[c + 1] = total.error;
+        }
+        return i;
+      }
+
+      // The weight and sum of the columns [first_col, end_col) between the 
+      // top and bottom rows of the table
+      inline std::pair<double, double> summed_area_lookup(const summed_area_row& top
+        , const summed_area_row& bottom, int first_col, int end_col)
+      {
+        const std::int64_t weight = bottom.weights[end_col] - bottom.weights[first_col]
+          - top.weights[end_col] + top.weights[first_col];
+        // The corners are large compared to their difference, so their 
+        // subtraction is compensated too
+        compensated_sum sum;
+        sum.add(bottom.sums[end_col]);
+        sum.add(-top.sums[end_col]);
+        sum.add(-bottom.sums[first_col]);
+        sum.add(top.sums[first_col]);
+        sum.error += (bottom.errors[end_col] - top.errors[end_col])
+          - (bottom.errors[first_col] - top.errors[first_col]);
+        return { static_cast<double>(weight), sum.sum + sum.error };
+      }
+    } // detail
+
+    class summed_area_table
+    {
+    public:
+      summed_area_table() : m_rows(0), m_cols(0)
+      {}
+
+      // Cells without data (uninitialized optionals) are not counted
+      template<class Raster, class RasterAllocator = default_raster_allocator>
+      summed_area_table(const Raster& raster
+        , RasterAllocator allocator = RasterAllocator{})
+        : m_rows(raster.rows()), m_cols(raster.cols())
+      {
+        using table_type = decltype(allocator.template allocate<double>(0, 0));
+        static_assert(std::is_same_v<table_type, memory_raster<double> >
+          , "the summed area table must be stored in a memory_raster");
+        m_weights = allocator.template allocate<std::int64_t>(m_rows + 1, m_cols + 1);
+        m_sums = allocator.template allocate<double>(m_rows + 1, m_cols + 1);
+        m_errors = allocator.template allocate<double>(m_rows + 1, m_cols + 1);
+        build(raster);
+      }
+
+      int rows() const
+      {
+        return m_rows;
+      }
+
+      int cols() const
+      {
+        return m_cols;
+      }
+
+      // The number of samples and their sum in the rectangle
+      std::pair<double, double> weight_and_sum(int first_row, int first_col
+        , int rows, int cols) const
+      {
+        return detail::summed_area_lookup(row(first_row), row(first_row + rows)
+          , first_col, first_col + cols);
+      }
+
+      // The number of samples in the rectangle
+      double weight(int first_row, int first_col, int rows, int cols) const
+      {
+        return weight_and_sum(first_row, first_col, rows, cols).first;
+      }
+
+      // The sum of the samples in the rectangle
+      double sum(int first_row, int first_col, int rows, int cols) const
+      {
+        return weight_and_sum(first_row, first_col, rows, cols).second;
+      }
+
+    private:
+      template<class Raster>
+      void build(const Raster& raster)
+      {
+        // Row 0 and column 0 are zero, as allocated
+        auto i = raster.begin();
+        for (int r = 0; r < m_rows; ++r) {
+          i = detail::add_summed_area_row(i, m_cols, row(r), row(r + 1));
+        }
+      }
+
+      template<class T>
+      static T* row(const memory_raster<T>& table, int r)
+      {
+        return table.data() + static_cast<std::ptrdiff_t>(r) * table.stride();
+      }
+
+      detail::summed_area_row row(int r) const
+      {
+        return detail::summed_area_row{ row(m_weights, r), row(m_sums, r)
+          , row(m_errors, r) };
+      }
+
+      memory_raster<std::int64_t> m_weights;
+      memory_raster<double> m_sums;
+      memory_raster<double> m_errors;
+      int m_rows;
+      int m_cols;
+    };
+
+    // Calculates the indicator for the windows of (2 * radius + 1) x 
+    // (2 * radius + 1) cells around the cells of rows [first_row, first_row +
+    // rows) of the raster, and assigns these to out. The summed area table 
+    // of the rows is built on the fly in a ring buffer of 2 * radius + 2 
+    // rows, starting radius rows above first_row. 
+    template<class Raster, class IndicatorGenerator, class RasterOut>
+    void summed_area_windows(const Raster& raster, int radius
+      , const IndicatorGenerator& indicator_generator, RasterOut& out
+      , int first_row, int rows)
+    {
+      using indicator = typename IndicatorGenerator::indicator;
+      const int raster_rows = raster.rows();
+      const int cols = raster.cols();
+      if (rows <= 0 || cols <= 0) return;
+
+      // The table rows are relative to the first row that is read
+      const int top = std::max(0, first_row - radius);
+      const int end = std::min(raster_rows, first_row + rows + radius);
+      const int ring_size = std::min(2 * radius + 2, end - top + 1);
+      const std::size_t row_size = static_cast<std::size_t>(cols) + 1;
+      std::vector<std::int64_t> weights(ring_size * row_size, 0);
+      std::vector<double> sums(ring_size * row_size, 0.0);
+      std::vector<double> errors(ring_size * row_size, 0.0);
+      auto table_row = [&](int k) {
+        const std::size_t offset = static_cast<std::size_t>(k % ring_size) * row_size;
+        return detail::summed_area_row{ weights.data() + offset
+          , sums.data() + offset, errors.data() + offset };
+      };
+
+      auto in = raster.sub_raster(top, 0, end - top, cols);
+      auto i = in.begin();
+      int table_rows = 1; // the first row of the table is zero
+      auto o = out.begin();
+      for (int r = first_row; r < first_row + rows; ++r) {
+        const int window_top = std::max(0, r - radius) - top;
+        const int window_end = std::min(raster_rows, r + radius + 1) - top;
+        while (table_rows <= window_end) {
+          i = detail::add_summed_area_row(i, cols, table_row(table_rows - 1)
+            , table_row(table_rows));
+          ++table_rows;
+        }
+        const detail::summed_area_row top_row = table_row(window_top);
+        const detail::summed_area_row bottom_row = table_row(window_end);
+        for (int c = 0; c < cols; ++c, ++o) {
+          const auto [weight, sum] = detail::summed_area_lookup(top_row, bottom_row
+            , std::max(0, c - radius), std::min(cols, c + radius + 1));
+          indicator ind = indicator_generator();
+          ind.set_weight_and_sum(weight, sum);
+          *o = ind.extract();
+        }
+      }
+    }
+
+    template<class IndicatorGenerator> class summed_area_window_view;
+
+    template<class IndicatorGenerator>
+    class summed_area_window_iterator
+      : public iterator_facade<summed_area_window_iterator<IndicatorGenerator> >
+    {
+    public:
+      static const bool is_mutable = false;
+      static const bool is_single_pass = false;
+
+      using indicator = typename IndicatorGenerator::indicator;
+      using value_type = indicator;
+
+      summed_area_window_iterator() : m_view(nullptr), m_index(0)
+      {}
+
+      summed_area_window_iterator(const summed_area_window_view<IndicatorGenerator>* view
+        , std::ptrdiff_t index) : m_view(view), m_index(index)
+      {}
+
+      indicator dereference() const
+      {
+        const int cols = m_view->cols();
+        return m_view->get(static_cast<int>(m_index / cols)
+          , static_cast<int>(m_index % cols));
+      }
+
+      void increment()
+      {
+        ++m_index;
+      }
+
+      void decrement()
+      {
+        --m_index;
+      }
+
+      void advance(std::ptrdiff_t n)
+      {
+        m_index += n;
+      }
+
+      bool equal_to(const summed_area_window_iterator& that) const
+      {
+        return m_index == that.m_index;
+      }
+
+      std::ptrdiff_t distance_to(const summed_area_window_iterator& that) const
+      {
+        return that.m_index - m_index;
+      }
+
+    private:
+      const summed_area_window_view<IndicatorGenerator>* m_view;
+      std::ptrdiff_t m_index;
+    };
+
+    template<class IndicatorGenerator>
+    class summed_area_window_view
+      : public std::ranges::view_interface<summed_area_window_view<IndicatorGenerator> >
+    {
+    public:
+      using indicator = typename IndicatorGenerator::indicator;
+      using iterator = summed_area_window_iterator<IndicatorGenerator>;
+
+      static_assert(LinearAccumulator<indicator, double>
+        , "summed area tables only support linear accumulators");
+
+      summed_area_window_view() = default;
+
+      summed_area_window_view(const summed_area_table& table, int rows_before
+        , int rows_after, int cols_before, int cols_after
+        , const IndicatorGenerator& indicator_generator)
+        : m_table(table), m_indicator_generator(indicator_generator)
+        , m_rows_before(rows_before), m_rows_after(rows_after)
+        , m_cols_before(cols_before), m_cols_after(cols_after)
+        , m_first_row(0), m_first_col(0)
+        , m_rows(table.rows()), m_cols(table.cols())
+      {}
+
+      int rows() const
+      {
+        return m_rows;
+      }
+
+      int cols() const
+      {
+        return m_cols;
+      }
+
+      int size() const
+      {
+        return m_rows * m_cols;
+      }
+
+      iterator begin() const
+      {
+        return iterator(this, 0);
+      }
+
+      iterator end() const
+      {
+        return iterator(this, size());
+      }
+
+      summed_area_window_view sub_raster(int first_row, int first_col
+        , int rows, int cols) const
+      {
+        summed_area_window_view out = *this;
+        out.m_first_row = m_first_row + first_row;
+        out.m_first_col = m_first_col + first_col;
+        out.m_rows = rows;
+        out.m_cols = cols;
+        return out;
+      }
+
+      // The indicator for the window around the cell
+      indicator get(int row, int col) const
+      {
+        const int r = m_first_row + row;
+        const int c = m_first_col + col;
+        const int first_row = std::max(0, r - m_rows_before);
+        const int end_row = std::min(m_table.rows(), r + m_rows_after + 1);
+        const int first_col = std::max(0, c - m_cols_before);
+        const int end_col = std::min(m_table.cols(), c + m_cols_after + 1);
+
+        const auto [weight, sum] = m_table.weight_and_sum(first_row, first_col
+          , end_row - first_row, end_col - first_col);
+        indicator i = m_indicator_generator();
+        i.set_weight_and_sum(weight, sum);
+        return i;
+      }
+
+    private:
+      summed_area_table m_table;
+      IndicatorGenerator m_indicator_generator;
+      int m_rows_before;
+      int m_rows_after;
+      int m_cols_before;
+      int m_cols_after;
+      int m_first_row;
+      int m_first_col;
+      int m_rows;
+      int m_cols;
+    };
+
+    template<class IndicatorGenerator>
+    summed_area_window_view<IndicatorGenerator> make_summed_area_window_view(
+      const summed_area_table& table, int radius
+      , const IndicatorGenerator& indicator_generator)
+    {
+      return summed_area_window_view<IndicatorGenerator>(table, radius, radius
+        , radius, radius, indicator_generator);
+    }
+  }
+}
@@ -0,0 +1,199 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+// Divides a raster in tiles and processes these tiles on a number of threads.
+// Each thread starts with a contiguous range of tiles (to preserve locality)
+// and steals tiles from the back of other threads' queues when it runs out.
+// The threads are started for each call and joined before it returns, so 
+// tasks should be large enough to outweigh the cost of starting a thread.
+//
+
+#pragma once
+
+#include <algorithm> // std::min, std::max
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pronto
+{
+  namespace raster
+  {
+    struct tile
+    {
+      int first_row;
+      int first_col;
+      int rows;
+      int cols;
+    };
+
+    // Tiles cover a raster of rows x cols. The tile boundaries are aligned
+    // to a grid of tile_rows x tile_cols that starts row_offset rows and
+    // col_offset columns before the raster. This is used to align tiles to
+    // the blocks of sub-rasters of a GDALRasterBand.
+    class tile_grid
+    {
+    public:
+      tile_grid(int rows, int cols, int tile_rows, int tile_cols
+        , int row_offset = 0, int col_offset = 0)
+        : m_rows(rows), m_cols(cols), m_tile_rows(tile_rows)
+        , m_tile_cols(tile_cols), m_row_offset(row_offset % tile_rows)
+        , m_col_offset(col_offset % tile_cols)
+      {
+        m_major_rows = (m_rows + m_row_offset + m_tile_rows - 1) / m_tile_rows;
+        m_major_cols = (m_cols + m_col_offset + m_tile_cols - 1) / m_tile_cols;
+        if (m_rows == 0 || m_cols == 0) {
+          m_major_rows = 0;
+          m_major_cols = 0;
+        }
+      }
+
+      int size() const
+      {
+        return m_major_rows * m_major_cols;
+      }
+
+      tile operator[](int i) const
+      {
+        const int major_row = i / m_major_cols;
+        const int major_col = i % m_major_cols;
+        const int first_row = std::max(0, major_row * m_tile_rows - m_row_offset);
+        const int first_col = std::max(0, major_col * m_tile_cols - m_col_offset);
+        const int end_row = std::min(m_rows, (major_row + 1) * m_tile_rows - m_row_offset);
+        const int end_col = std::min(m_cols, (major_col + 1) * m_tile_cols - m_col_offset);
+        return tile{ first_row, first_col, end_row - first_row, end_col - first_col };
+      }
+
+    private:
+      int m_rows;
+      int m_cols;
+      int m_tile_rows;
+      int m_tile_cols;
+      int m_row_offset;
+      int m_col_offset;
+      int m_major_rows;
+      int m_major_cols;
+    };
+
+    namespace detail {
+      class work_stealing_queue
+      {
+      public:
+        void push(int task)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_tasks.push_back(task);
+        }
+
+        bool pop(int& task)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_tasks.empty()) return false;
+          task = m_tasks.front();
+          m_tasks.pop_front();
+          return true;
+        }
+
+        bool steal(int& task)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_tasks.empty()) return false;
+          task = m_tasks.back();
+          m_tasks.pop_back();
+          return true;
+        }
+
+        void clear()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_tasks.clear();
+        }
+
+      private:
+        std::mutex m_mutex;
+        std::deque<int> m_tasks;
+      };
+    } // detail
+
+    inline int default_number_of_threads()
+    {
+      return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Calls f(task, thread_index) for each task in [0, num_tasks). The first
+    // exception thrown by f is rethrown after all threads have finished,
+    // remaining tasks are then skipped.
+    template<class F>
+    void parallel_for_each_task(int num_tasks, F&& f
+      , int num_threads = default_number_of_threads())
+    {
+      num_threads = std::max(1, std::min(num_threads, num_tasks));
+      if (num_threads == 1) {
+        for (int task = 0; task < num_tasks; ++task) {
+          f(task, 0);
+        }
+        return;
+      }
+
+      std::vector<detail::work_stealing_queue> queues(num_threads);
+      for (int i = 0; i < num_threads; ++i) {
+        const int begin = static_cast<int>(static_cast<long long>(num_tasks) * i / num_threads);
+        const int end = static_cast<int>(static_cast<long long>(num_tasks) * (i + 1) / num_threads);
+        for (int task = begin; task < end; ++task) {
+          queues[i].push(task);
+        }
+      }
+
+      std::exception_ptr first_exception;
+      std::mutex exception_mutex;
+
+      auto worker = [&](int thread_index) {
+        int task;
+        while (true) {
+          bool found = queues[thread_index].pop(task);
+          for (int i = 1; !found && i < num_threads; ++i) {
+            found = queues[(thread_index + i) % num_threads].steal(task);
+          }
+          // no new tasks are added, so when all queues are empty we are done
+          if (!found) return;
+          try {
+            f(task, thread_index);
+          }
+          catch (...) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            if (!first_exception) first_exception = std::current_exception();
+            for (auto& q : queues) q.clear();
+          }
+        }
+      };
+
+      std::vector<std::thread> threads;
+      for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker, i);
+      }
+      worker(0);
+      for (auto& t : threads) {
+        t.join();
+      }
+      if (first_exception) std::rethrow_exception(first_exception);
+    }
+
+    // Calls f(tile, thread_index) for each tile of the grid
+    template<class F>
+    void parallel_for_each_tile(const tile_grid& grid, F&& f
+      , int num_threads = default_number_of_threads())
+    {
+      parallel_for_each_task(grid.size(), [&](int task, int thread_index) {
+        f(grid[task], thread_index);
+        }, num_threads);
+    }
+  }
+}
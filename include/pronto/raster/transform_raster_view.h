@@ -11,11 +11,15 @@
 #pragma once
 
 #include <pronto/raster/iterator_facade.h>
+#include <pronto/raster/stretch.h>
 #include <pronto/raster/traits.h>
 
 #include <iterator>
+#include <memory>
 #include <utility>
 #include <optional>
+#include <span>
+#include <tuple>
 
 namespace pronto {
   namespace raster {
@@ -149,6 +153,33 @@ namespace pronto {
         return std::apply([&](auto&&... rasters) {return sub_raster_type(*m_function, rasters.sub_raster(start_row, start_col, rows, cols)...); }, m_rasters);
       }
  
+      static const bool has_stretches = (StretchRasterConcept<R> && ...);
+      static const bool has_mutable_stretches = false;
+
+      // Rows of the input rasters are read into buffers, so that the 
+      // function is applied in a tight loop over contiguous memory.
+      template<class G>
+      void for_each_stretch(G&& g) const requires has_stretches
+      {
+        const int r = rows();
+        const int c = cols();
+        auto in_buffers = std::make_tuple(
+          std::make_unique<typename traits<R>::value_type[]>(c)...);
+        auto out_buffer = std::make_unique<value_type[]>(c);
+        auto& fun = *m_function;
+        for (int row = 0; row < r; ++row) {
+          std::apply([&](auto&... buffers) {
+            std::apply([&](auto&... rasters) {
+              (..., read_row(rasters, row, buffers.get()));
+              }, m_rasters);
+            for (int col = 0; col < c; ++col) {
+              out_buffer[col] = fun(buffers[col]...);
+            }
+            }, in_buffers);
+          g(row, 0, std::span<const value_type>(out_buffer.get(), c));
+        }
+      }
+
       std::tuple<R...> m_rasters;
     private:
       //friend class const_iterator;
@@ -27,6 +27,8 @@ namespace pronto {
       static const bool is_mutable = true;
       using value_type = std::tuple<std::iter_value_t<I>...>;
 
+      tuple_raster_iterator() = default;
+
       tuple_raster_iterator(const I& ...iters) : m_iters(iters...)
       {
       }
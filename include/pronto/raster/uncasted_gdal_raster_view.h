@@ -19,11 +19,13 @@
 #include <pronto/raster/gdal_raster_view.h>
 #include <pronto/raster/nodata_transform.h>
 #include <pronto/raster/optional.h>
+#include <pronto/raster/stretch.h>
 
 #include <cassert>
 #include <cstdint>
 #include <memory>
 #include <ranges>
+#include <span>
 #include <type_traits>
 #include <filesystem>
 #include <variant>
@@ -39,14 +41,15 @@ namespace pronto
 
       uncasted_block() = default;
 
-      void reset(GDALRasterBand* band, int major_row, int major_col)
+      void reset(GDALRasterBand* band, int major_row, int major_col
+        , std::mutex* mutex = nullptr)
       {
         // Avoid rereading same block
         if (m_block && m_block->GetBand() == band
           && major_row == this->major_row() && major_col == this->major_col())
           return;
 
-        GDALRasterBlock* block = band->GetLockedBlockRef(major_col, major_row);
+        GDALRasterBlock* block = detail::get_locked_block(band, major_row, major_col, mutex);
         if (block == nullptr) {
           assert(false);
           throw("trying to open inaccessible GDALRasterBlock");
@@ -97,9 +100,9 @@ namespace pronto
         return nullptr;
       }
 
-      void mark_dirty() const //mutable
+      void mark_dirty(std::mutex* mutex = nullptr) const //mutable
       {
-        m_block->MarkDirty();
+        detail::mark_block_dirty(m_block.get(), mutex);
       }
 
     private:
@@ -297,6 +300,7 @@ namespace pronto
           int block_cols = 0;
 
           m_view->m_band->GetBlockSize(&block_cols, &block_rows);
+          const gdal_band_pool::thread_band thread_band = m_view->m_pool->get();
 
           int block_row = gdaldata_row / block_rows;
           int block_col = gdaldata_col / block_cols;
@@ -304,10 +308,10 @@ namespace pronto
           int row_in_block = gdaldata_row % block_rows;
           int col_in_block = gdaldata_col % block_cols;
 
-          m_block.reset(m_view->m_band.get(), block_row, block_col);
+          m_block.reset(thread_band.band, block_row, block_col, thread_band.mutex);
           if constexpr (is_mutable) {
             if (m_view->m_band->GetAccess() == GA_Update) {
-              m_block.mark_dirty();
+              m_block.mark_dirty(thread_band.mutex);
             }
           }
 
@@ -339,7 +343,7 @@ namespace pronto
       using value_type = T;
 
       uncasted_gdal_raster_view(std::shared_ptr<GDALRasterBand> band)
-        : m_band(band), m_rows(band->GetYSize()), m_cols(band->GetXSize()), m_first_row(0), m_first_col(0)
+        : m_band(band), m_pool(std::make_shared<gdal_band_pool>(band)), m_rows(band->GetYSize()), m_cols(band->GetXSize()), m_first_row(0), m_first_col(0)
       {
         GDALDataType datatype = m_band->GetRasterDataType();
         //assert(datatype == gdal_data_type<value_type>); //GDALDataType must be consistent with value_type;
@@ -411,7 +415,7 @@ namespace pronto
 
         uncasted_gdal_raster_view sub_raster(int first_row, int first_col, int rows, int cols) const
         {
-          uncasted_gdal_raster_view out{ m_band };
+          uncasted_gdal_raster_view out = *this; // shares the band pool
           out.m_first_row = m_first_row + first_row;
           out.m_first_col = m_first_col + first_col;
           out.m_rows = rows;
@@ -447,11 +451,73 @@ namespace pronto
           else m_band->DeleteNoDataValue();
         }
 
+        int get_first_row() const
+        {
+          return m_first_row;
+        }
+
+        int get_first_col() const
+        {
+          return m_first_col;
+        }
+
+        static const bool has_stretches = true;
+        static const bool has_mutable_stretches = AccessType != access::read_only;
+        using stretch_type = std::conditional_t<has_mutable_stretches
+          , std::span<T>, std::span<const T> >;
+
+        // Calls f(row, col, stretch) for the part of each row that falls in
+        // one GDAL block. The stretch refers to the block directly.
+        template<class F>
+        void for_each_stretch(F&& f) const
+        {
+          int block_rows = 0;
+          int block_cols = 0;
+          m_band->GetBlockSize(&block_cols, &block_rows);
+
+          const gdal_band_pool::thread_band thread_band = m_pool->get();
+          uncasted_block<T, AccessType> block;
+          detail::for_each_block_stretch(m_first_row, m_first_col, m_rows, m_cols
+            , block_rows, block_cols
+            , [&](int row, int col, int major_row, int major_col
+              , int minor_row, int minor_col, int n)
+            {
+              block.reset(thread_band.band, major_row, major_col, thread_band.mutex);
+              if constexpr (has_mutable_stretches) {
+                if (m_band->GetAccess() == GA_Update) {
+                  block.mark_dirty(thread_band.mutex);
+                }
+              }
+              f(row, col, stretch_type(block.get_iterator(minor_row, minor_col), n));
+            });
+        }
+
+        // Reads all cells of the (sub-)raster into out in row-major order,
+        // GDAL converts from the data type of the band to U.
+        template<class U>
+        void read_into(std::span<U> out) const
+        {
+          assert(out.size() >= static_cast<std::size_t>(size()));
+          detail::raster_io(*m_pool, GF_Read, m_first_row, m_first_col
+            , m_rows, m_cols, out.data());
+        }
+
+        // Writes size() values in row-major order to the (sub-)raster
+        template<class U>
+        void write_from(std::span<const U> in) const
+          requires (AccessType != access::read_only)
+        {
+          assert(in.size() >= static_cast<std::size_t>(size()));
+          detail::raster_io(*m_pool, GF_Write, m_first_row, m_first_col
+            , m_rows, m_cols, const_cast<U*>(in.data()));
+        }
+
     private:
       //friend class iterator;
       //friend class const_iterator;
       friend class uncasted_gdal_raster_iterator<value_type, IterationType, AccessType>;
       std::shared_ptr<GDALRasterBand> m_band;
+      std::shared_ptr<gdal_band_pool> m_pool;
       int m_rows;
       int m_cols;
       int m_first_row;
@@ -11,16 +11,40 @@
 
 
 #include <pronto/raster/traits.h>
+#include <pronto/raster/reference_proxy.h>
 #include <pronto/raster/reference_proxy_vector.h>
 
 #include <iterator>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace pronto {
   namespace raster {
     
     template<class> class vector_of_raster_view;
 
+    namespace detail {
+      // Gives put and get access to a true reference 
+      template<class T>
+      struct true_reference_accessor
+      {
+        using value_type = T;
+
+        T get() const
+        {
+          return *m_ref;
+        }
+
+        void put(const T& v) const
+        {
+          *m_ref = v;
+        }
+
+        T* m_ref;
+      };
+    }
+
     template<class Raster, bool IsMutable> 
     class vector_of_raster_iterator
     { 
@@ -30,9 +54,26 @@ namespace pronto {
         , typename traits<Raster>::iterator
         , typename traits<Raster>::const_iterator>::type;
 
+      // A std::vector cannot hold true references (e.g. of memory_raster),
+      // for these it holds proxies instead, or values when the references
+      // are const
+      using single_true_reference = 
+        typename std::iterator_traits<single_iterator>::reference;
+      static constexpr bool is_true_reference 
+        = std::is_reference_v<single_true_reference>;
+      static constexpr bool is_const_reference = is_true_reference
+        && std::is_const_v<std::remove_reference_t<single_true_reference> >;
+
+      using single_reference = std::conditional_t<is_const_reference
+        , typename std::iterator_traits<single_iterator>::value_type
+        , std::conditional_t<is_true_reference
+          , put_get_proxy_reference<detail::true_reference_accessor<
+              typename std::iterator_traits<single_iterator>::value_type> >
+          , single_true_reference> >;
+
       using reference = reference_proxy_vector <
         typename std::iterator_traits<single_iterator>::value_type, 
-        typename std::iterator_traits<single_iterator>::reference>;
+        single_reference>;
 
       using value_type = std::vector< 
         typename std::iterator_traits<single_iterator>::value_type>;
@@ -102,12 +143,17 @@ namespace pronto {
 
       reference operator*() const
       {
-        reference r(m_iters.size());
-        auto i = m_iters.begin();
-        auto j = r.begin();
-        for (;i != m_iters.end(); ++i, ++j)
-        {
-          *j = **i;
+        reference r;
+        r.reserve(m_iters.size());
+        for (auto&& i : m_iters) {
+          if constexpr (is_true_reference && !is_const_reference) {
+            using accessor = detail::true_reference_accessor<
+              typename std::iterator_traits<single_iterator>::value_type>;
+            r.emplace_back(accessor{ &*i });
+          }
+          else {
+            r.emplace_back(*i);
+          }
         }
         return r;
       }
@@ -27,6 +27,11 @@ namespace pronto
         papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "LZW");
         // papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "YES");
 
+        // Dirty blocks that are evicted from the block cache or flushed are
+        // queued and compressed by a pool of worker threads of the GTiff
+        // driver, rather than on the thread that writes the values.
+        papszOptions = CSLSetNameValue(papszOptions, "NUM_THREADS", "ALL_CPUS");
+
         GDALDataset* dataset = driver->Create(path.string().c_str(), cols, rows
           , nBands, datatype, papszOptions);
         return dataset;
@@ -0,0 +1,118 @@
+#include <pronto/raster/exceptions.h>
+#include <pronto/raster/mapped_raster.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h> // mkstemp
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace pronto
+{
+  namespace raster
+  {
+    namespace detail
+    {
+#ifdef _WIN32
+      std::shared_ptr<void> map_temp_file(std::size_t bytes, access_pattern)
+      {
+        if (bytes == 0) return std::shared_ptr<void>{};
+
+        wchar_t path[MAX_PATH];
+        const std::wstring dir = std::filesystem::temp_directory_path().wstring();
+        if (GetTempFileNameW(dir.c_str(), L"pr", 0, path) == 0) {
+          throw(creating_a_raster_failed{});
+        }
+        // The file is deleted when the last handle to it is closed
+        HANDLE file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, NULL
+          , CREATE_ALWAYS
+          , FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+          throw(creating_a_raster_failed{});
+        }
+        const unsigned long long size = bytes;
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE
+          , static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xffffffff)
+          , NULL);
+        if (mapping == NULL) {
+          CloseHandle(file);
+          throw(creating_a_raster_failed{});
+        }
+        void* first = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if (first == NULL) {
+          CloseHandle(mapping);
+          CloseHandle(file);
+          throw(creating_a_raster_failed{});
+        }
+        return std::shared_ptr<void>(first, [file, mapping](void* p) {
+          UnmapViewOfFile(p);
+          CloseHandle(mapping);
+          CloseHandle(file);
+          });
+      }
+
+      // Windows has no equivalent of madvise for mapped files
+      void advise_mapped_range(void*, std::size_t, access_pattern)
+      {}
+#else
+      namespace {
+        int to_advice(access_pattern pattern)
+        {
+          switch (pattern) {
+          case access_pattern::sequential: return MADV_SEQUENTIAL;
+          case access_pattern::random: return MADV_RANDOM;
+          default: return MADV_NORMAL;
+          }
+        }
+      }
+
+      std::shared_ptr<void> map_temp_file(std::size_t bytes, access_pattern pattern)
+      {
+        if (bytes == 0) return std::shared_ptr<void>{};
+
+        auto model = std::filesystem::temp_directory_path() / "pronto-XXXXXX";
+        std::string path = model.string();
+        int fd = mkstemp(path.data());
+        if (fd == -1) {
+          throw(creating_a_raster_failed{});
+        }
+        // Unlinking immediately makes sure the file is removed, even when
+        // the process does not terminate normally.
+        unlink(path.c_str());
+
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+          close(fd);
+          throw(creating_a_raster_failed{});
+        }
+        void* first = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd); // the mapping keeps the file alive
+        if (first == MAP_FAILED) {
+          throw(creating_a_raster_failed{});
+        }
+        madvise(first, bytes, to_advice(pattern));
+        return std::shared_ptr<void>(first, [bytes](void* p) { munmap(p, bytes); });
+      }
+
+      void advise_mapped_range(void* first, std::size_t bytes, access_pattern pattern)
+      {
+        // madvise requires the address to be aligned to a page
+        const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        char* begin = static_cast<char*>(first);
+        char* aligned = reinterpret_cast<char*>(
+          reinterpret_cast<std::uintptr_t>(begin) / page * page);
+        madvise(aligned, bytes + (begin - aligned), to_advice(pattern));
+      }
+#endif
+    }
+  }
+}
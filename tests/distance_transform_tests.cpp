@@ -0,0 +1,94 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+#define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
+#include <gtest/gtest.h>
+
+#include <pronto/raster/distance_transform.h>
+#include <pronto/raster/memory_raster.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace pr = pronto::raster;
+
+// Brute force distance to the nearest target
+template<class Distance>
+std::vector<long long> nearest_target(const std::vector<int>& values
+  , int rows, int cols, int target, Distance distance)
+{
+  std::vector<long long> out;
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      long long nearest = -1;
+      for (int i = 0; i < rows * cols; ++i) {
+        if (values[i] != target) continue;
+        const long long d = distance(std::abs(i / cols - r), std::abs(i % cols - c));
+        if (nearest == -1 || d < nearest) nearest = d;
+      }
+      out.push_back(nearest);
+    }
+  }
+  return out;
+}
+
+bool test_parallel_distance_transform()
+{
+  // More rows than the chunks of bands that are written at once
+  const int rows = 145;
+  const int cols = 37;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    // Few targets, so distances cross many strips and bands
+    v = (i * 7919) % 97 == 0 ? 1 : 0;
+    values.push_back(v);
+    ++i;
+  }
+
+  auto squared = nearest_target(values, rows, cols, 1
+    , [](long long dr, long long dc) { return dr * dr + dc * dc; });
+  auto manhattan = nearest_target(values, rows, cols, 1
+    , [](long long dr, long long dc) { return dr + dc; });
+  auto chessboard = nearest_target(values, rows, cols, 1
+    , [](long long dr, long long dc) { return std::max(dr, dc); });
+
+  bool ok = true;
+  for (int num_threads : { 1, 4 }) {
+    pr::memory_raster<long long> d(rows, cols);
+    ok = ok && pr::parallel_distance_transform(a, d, 1, pr::euclidean{}
+      , pr::post_process_none{}, num_threads);
+    ok = ok && std::equal(d.begin(), d.end(), squared.begin());
+
+    ok = ok && pr::parallel_distance_transform(a, d, 1, pr::manhattan{}
+      , pr::post_process_none{}, num_threads);
+    ok = ok && std::equal(d.begin(), d.end(), manhattan.begin());
+
+    ok = ok && pr::parallel_distance_transform(a, d, 1, pr::chessboard{}
+      , pr::post_process_none{}, num_threads);
+    ok = ok && std::equal(d.begin(), d.end(), chessboard.begin());
+
+    pr::memory_raster<double> e(rows, cols);
+    ok = ok && pr::parallel_euclidean_distance_transform(a, e, 1, num_threads);
+    ok = ok && std::equal(e.begin(), e.end(), squared.begin()
+      , [](double x, long long y) { return x == std::sqrt(y); });
+
+    // There is no target
+    ok = ok && !pr::parallel_distance_transform(a, d, 2, pr::euclidean{}
+      , pr::post_process_none{}, num_threads);
+  }
+  return ok;
+}
+
+TEST(RasterTest, DistanceTransform) {
+  EXPECT_TRUE(test_parallel_distance_transform());
+}
@@ -10,9 +10,12 @@
 #define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
 #include <gtest/gtest.h>
 
+#include <pronto/raster/assign.h>
 #include <pronto/raster/io.h>
 #include <pronto/raster/gdal_raster_view.h>
+#include <pronto/raster/transform_raster_view.h>
 #include <ranges>
+#include <span>
 #include <vector>
 
 
@@ -151,6 +154,157 @@ bool test_empty_gdal_raster_view_zero_cols()
   return r.size() == 0 && r.rows() == 1 && r.cols() == 0;
 }
 
+bool test_native_and_converted_access()
+{
+  // same data type as the band: values are accessed directly
+  auto native = pr::create_temp<int>(3, 2, GDT_Int32);
+
+  // different data type: values are converted on access
+  auto converted = pr::create_temp<int>(3, 2, GDT_Float64);
+
+  for (int num = 0; auto && i : native) {
+    i = num++;
+  }
+  for (int num = 0; auto && i : converted) {
+    i = num++;
+  }
+  std::vector<int> check_native;
+  for (auto&& i : native) {
+    check_native.push_back(i);
+  }
+  std::vector<int> check_converted;
+  for (auto&& i : converted) {
+    check_converted.push_back(i);
+  }
+  auto expected = std::vector<int>{ 0, 1, 2, 3, 4, 5 };
+  return check_native == expected && check_converted == expected;
+}
+
+bool test_for_each_stretch()
+{
+  auto r = pr::create_temp<int>(4, 5);
+  for (int num = 0; auto && i : r) {
+    i = num++;
+  }
+  // visit the sub_raster by stretches and double all values
+  auto sub = r.sub_raster(1, 1, 2, 3);
+  std::vector<int> visited;
+  sub.for_each_stretch([&](int row, int col, std::span<int> stretch) {
+    for (auto& v : stretch) {
+      visited.push_back(v);
+      v *= 2;
+    }
+    });
+  std::vector<int> check;
+  for (auto&& i : sub) {
+    check.push_back(i);
+  }
+  return visited == std::vector<int>{6, 7, 8, 11, 12, 13}
+    && check == std::vector<int>{12, 14, 16, 22, 24, 26};
+}
+
+bool test_read_into_write_from()
+{
+  auto r = pr::create_temp<int>(4, 5, GDT_Float32);
+  for (int num = 0; auto && i : r) {
+    i = num++;
+  }
+  // GDAL converts from GDT_Float32 to double and back
+  auto sub = r.sub_raster(1, 1, 2, 3);
+  std::vector<double> values(sub.size());
+  sub.read_into(std::span<double>(values));
+  bool ok = values == std::vector<double>{6, 7, 8, 11, 12, 13};
+  for (auto& v : values) {
+    v *= 2;
+  }
+  sub.write_from(std::span<const double>(values));
+  std::vector<int> check;
+  for (auto&& i : sub) {
+    check.push_back(i);
+  }
+  ok = ok && check == std::vector<int>{12, 14, 16, 22, 24, 26};
+
+  // assign between gdal_raster_views of native data types uses RasterIO
+  auto copy = pr::create_temp<double>(2, 3);
+  auto sub_int = pr::create_temp<int>(4, 5).sub_raster(1, 1, 2, 3);
+  pr::assign(sub_int, sub);
+  pr::assign(copy, sub_int);
+  std::vector<double> check_copy;
+  for (auto&& i : copy) {
+    check_copy.push_back(i);
+  }
+  ok = ok && check_copy == std::vector<double>{12, 14, 16, 22, 24, 26};
+
+  // bool has no RasterIO buffer type, and is assigned cell-by-cell
+  auto flags = pr::create_temp<bool>(2, 3);
+  auto flags_copy = pr::create_temp<bool>(2, 3);
+  pr::assign(flags, pr::transform([](int v) { return v > 20; }, sub_int));
+  pr::assign(flags_copy, flags);
+  std::vector<bool> check_flags;
+  for (auto&& i : flags_copy) {
+    check_flags.push_back(i);
+  }
+  return ok && check_flags == std::vector<bool>{false, false, false, true, true, true};
+}
+
+bool test_prefetch()
+{
+  const int rows = 300;
+  const int cols = 200;
+  {
+    auto model = pr::create_temp<int>(rows, cols);
+    auto r = pr::create_compressed_from_model<int>("prefetch.tif", model);
+    for (int num = 0; auto && i : r) {
+      i = num++;
+    }
+  } // leave scope
+  bool ok = true;
+  {
+    auto in = pr::open<int, pr::iteration_type::multi_pass, pr::access::read_only>("prefetch.tif");
+    auto prefetched = in.with_prefetch(1);
+
+    // visiting the blocks twice makes the prefetcher start over
+    for (int pass = 0; pass < 2; ++pass) {
+      for (int num = 0; auto && i : prefetched) {
+        ok = ok && i == num++;
+      }
+    }
+    auto sub = prefetched.sub_raster(100, 50, 20, 30);
+    for (int num = 0; auto && i : sub) {
+      ok = ok && i == (100 + num / 30) * cols + 50 + num % 30;
+      ++num;
+    }
+    prefetched.for_each_stretch([&](int row, int col, std::span<const int> stretch) {
+      for (auto& v : stretch) {
+        ok = ok && v == row * cols + col++;
+      }
+      });
+
+    // mutable stretches of a read-only band can be read, but not written
+    auto band = pr::detail::open_band(
+      pr::detail::open_dataset("prefetch.tif", pr::access::read_only));
+    auto mutable_view = pr::gdal_raster_view<int, pr::iteration_type::multi_pass
+      , pr::access::read_write>(band);
+    mutable_view.for_each_stretch([&](int row, int col, std::span<int> stretch) {
+      for (auto& v : stretch) {
+        ok = ok && v == row * cols + col++;
+      }
+      });
+    bool threw = false;
+    try {
+      mutable_view.for_each_stretch([&](int, int, std::span<int> stretch) {
+        stretch[0] = -1;
+        });
+    }
+    catch (const pr::writing_to_raster_failed&) {
+      threw = true;
+    }
+    ok = ok && threw && *in.begin() == 0;
+  }
+  fs::remove("prefetch.tif");
+  return ok;
+}
+
 TEST(RasterTest, ReferenceProxy) {
   EXPECT_TRUE(test_assign_reference_proxy());
   EXPECT_TRUE(test_increment_reference_proxy());
@@ -163,5 +317,9 @@ TEST(RasterTest, GdalRasterView) {
   EXPECT_TRUE(test_empty_gdal_raster_view());
   EXPECT_TRUE(test_empty_gdal_raster_view_zero_rows());
   EXPECT_TRUE(test_empty_gdal_raster_view_zero_cols());
+  EXPECT_TRUE(test_native_and_converted_access());
+  EXPECT_TRUE(test_for_each_stretch());
+  EXPECT_TRUE(test_read_into_write_from());
+  EXPECT_TRUE(test_prefetch());
 
 }
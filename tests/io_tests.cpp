@@ -10,11 +10,14 @@
 #define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
 #include <gtest/gtest.h>
 
+#include <pronto/raster/assign.h>
+#include <pronto/raster/gdal_band_pool.h>
 #include <pronto/raster/io.h>
 #include <pronto/raster/gdal_raster_view.h>
 #include <pronto/raster/raster_algebra_operators.h>
 #include <pronto/raster/raster_variant.h>
 
+#include <execution>
 #include <filesystem>
 #include <variant>
 #include <vector>
@@ -161,12 +164,54 @@ bool test_create_open_large()
   return check_exist && check_not_exist && check_contents;
 }
 
+bool test_open_read_in_parallel()
+{
+  int rows = 700;
+  int cols = 600;
+  {
+    auto r = pr::create<int>("temp.tif", rows, cols);
+    int count = 0;
+    for (auto&& i : r) {
+      i = count++;
+    }
+  } // leave scope
+  bool check_contents = true;
+  {
+    // each thread reads from its own handle to temp.tif
+    auto in = pr::open<int, pr::iteration_type::multi_pass, pr::access::read_only>("temp.tif");
+    auto out = pr::create_temp<int>(rows, cols);
+    pr::assign(std::execution::par, out, in);
+    int count = 0;
+    for (auto&& i : out) {
+      check_contents = check_contents && (i == count++);
+    }
+  }
+  fs::remove("temp.tif");
+  return check_contents;
+}
+
+bool test_shared_band_mutex()
+{
+  // bands that are not pooled use the mutex of their dataset, also when
+  // they are accessed via different views
+  auto r = pr::create_temp<int>(20, 30);
+  auto band = r.get_band();
+  pr::gdal_band_pool a(band);
+  pr::gdal_band_pool b(band);
+  auto other = pr::create_temp<int>(20, 30);
+  pr::gdal_band_pool c(other.get_band());
+  return !a.is_pooled() && a.get().mutex != nullptr
+    && a.get().mutex == b.get().mutex && a.get().mutex != c.get().mutex;
+}
+
 TEST(RasterTest, IO) {
   EXPECT_TRUE(test_create_temp());
   EXPECT_TRUE(test_create_temp_uncasted());
   EXPECT_TRUE(test_create());
   EXPECT_TRUE(test_open());
   EXPECT_TRUE(test_open_variant());
+  EXPECT_TRUE(test_open_read_in_parallel());
+  EXPECT_TRUE(test_shared_band_mutex());
 #ifdef NDEBUG // Don't debug large data file
   EXPECT_TRUE(test_create_open_large());
 #endif
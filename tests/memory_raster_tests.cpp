@@ -0,0 +1,157 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+#define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
+#include <gtest/gtest.h>
+
+#include <pronto/raster/assign.h>
+#include <pronto/raster/io.h>
+#include <pronto/raster/mapped_raster.h>
+#include <pronto/raster/memory_raster.h>
+#include <pronto/raster/raster.h>
+#include <pronto/raster/raster_allocator.h>
+#include <pronto/raster/stretch.h>
+#include <pronto/raster/transform_raster_view.h>
+#include <pronto/raster/vector_of_raster_view.h>
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace pr = pronto::raster;
+
+bool test_memory_raster_iteration()
+{
+  auto a = pr::memory_raster<int>(3, 4);
+  static_assert(pr::RasterConcept<decltype(a)>);
+  static_assert(std::ranges::random_access_range<decltype(a)>);
+
+  bool ok = true;
+  for (auto&& v : a) {
+    ok = ok && v == 0; // value-initialized
+  }
+  for (int i = 0; auto && v : a) {
+    v = i++;
+  }
+  auto sub = a.sub_raster(1, 1, 2, 2);
+  std::vector<int> vec(sub.begin(), sub.end());
+  ok = ok && vec == std::vector<int>{ 5, 6, 9, 10 };
+
+  // random access within the sub-raster
+  auto i = sub.begin();
+  ok = ok && i[3] == 10 && *(i + 2) == 9 && (sub.end() - i) == 4;
+  auto j = sub.end();
+  --j;
+  ok = ok && *j == 10 && *(--j) == 9 && *(--j) == 6;
+
+  // copies share the data
+  auto b = a;
+  *(b.begin() + 5) = 100;
+  ok = ok && *sub.begin() == 100;
+
+  // a raster without columns
+  auto empty = a.sub_raster(1, 2, 2, 0);
+  ok = ok && empty.begin() == empty.end() && (empty.end() - empty.begin()) == 0;
+  return ok;
+}
+
+bool test_memory_raster_vector()
+{
+  std::vector<pr::memory_raster<int> > rasters{ pr::memory_raster<int>(2, 3)
+    , pr::memory_raster<int>(2, 3) };
+  auto view = pr::raster_vector(rasters);
+
+  // writes go through to the memory_rasters
+  for (int i = 0; auto && v : view) {
+    v = std::vector<int>{ i, 10 * i };
+    ++i;
+  }
+  bool ok = true;
+  for (int i = 0; auto && v : rasters[1]) {
+    ok = ok && v == 10 * i++;
+  }
+  const auto& const_view = view;
+  for (int i = 0; auto && v : const_view) {
+    const std::vector<int> values = v;
+    ok = ok && values == std::vector<int>{ i, 10 * i };
+    ++i;
+  }
+  return ok;
+}
+
+bool test_memory_raster_assign()
+{
+  auto in = pr::create_temp<int>(5, 6);
+  for (int i = 0; auto && v : in) {
+    v = i++;
+  }
+  auto out = pr::memory_raster<int>(5, 6, -1);
+  pr::assign(out, pr::transform([](int v) {return 2 * v; }, in));
+
+  bool ok = true;
+  for (int i = 0; auto && v : out) {
+    ok = ok && v == 2 * i++;
+  }
+
+  // each row of a sub-raster is one stretch
+  int count = 0;
+  pr::for_each_stretch(out.sub_raster(1, 2, 3, 3), [&](int row, int col, auto stretch) {
+    ++count;
+    ok = ok && col == 0 && stretch.size() == 3 && stretch[0] == 2 * ((row + 1) * 6 + 2);
+    });
+  ok = ok && count == 3;
+
+  auto allocated = pr::default_raster_allocator{}.allocate<double>(2, 2);
+  static_assert(std::is_same_v<decltype(allocated), pr::memory_raster<double> >);
+  return ok && allocated.size() == 4;
+}
+
+bool test_memory_raster_size()
+{
+  // the size of a raster with more than 2^31 cells does not overflow, the
+  // data is not accessed
+  auto data = std::make_shared<char[]>(1);
+  auto a = pr::memory_raster<char>(data, 50000, 50000);
+  static_assert(std::is_same_v<decltype(a.size()), std::ptrdiff_t>);
+  return a.size() == std::ptrdiff_t{ 2500000000 }
+    && a.sub_raster(0, 0, 2, 3).size() == 6;
+}
+
+bool test_mapped_raster()
+{
+  auto a = pr::create_mapped_temp<double>(300, 400, pr::access_pattern::random);
+  bool ok = a.rows() == 300 && a.cols() == 400;
+  for (auto&& v : a) {
+    ok = ok && v == 0.0;
+  }
+  for (int i = 0; auto && v : a) {
+    v = 0.5 * i++;
+  }
+  auto sub = a.sub_raster(100, 150, 20, 30);
+  pr::advise(sub, pr::access_pattern::sequential);
+  for (int i = 0; auto && v : sub) {
+    const int row = 100 + i / 30;
+    const int col = 150 + i % 30;
+    ok = ok && v == 0.5 * (row * 400 + col);
+    ++i;
+  }
+
+  auto b = pr::mapped_raster_allocator{}.allocate<int>(10, 10);
+  pr::assign(b, pr::transform([](double v) {return static_cast<int>(v); }, a.sub_raster(0, 0, 10, 10)));
+  return ok && *(b.begin() + 11) == 200;
+}
+
+TEST(RasterTest, MemoryRaster) {
+  EXPECT_TRUE(test_memory_raster_iteration());
+  EXPECT_TRUE(test_memory_raster_vector());
+  EXPECT_TRUE(test_memory_raster_assign());
+  EXPECT_TRUE(test_memory_raster_size());
+  EXPECT_TRUE(test_mapped_raster());
+}
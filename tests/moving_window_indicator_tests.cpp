@@ -10,11 +10,25 @@
 #define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
 #include <gtest/gtest.h>
 
+#include <pronto/raster/assign.h>
 #include <pronto/raster/io.h>
+#include <pronto/raster/memory_raster.h>
 #include <pronto/raster/raster.h>
 #include <pronto/raster/moving_window_indicator.h>
+#include <pronto/raster/summed_area_table.h>
+#include <pronto/raster/tuple_raster_view.h>
 #include <pronto/raster/indicator/mean.h>
+#include <pronto/raster/indicator/count.h>
 #include <pronto/raster/indicator/edge_density.h>
+#include <pronto/raster/indicator/interspersion.h>
+#include <pronto/raster/indicator/most_common_class.h>
+#include <pronto/raster/indicator/shannon_diversity.h>
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <optional>
+#include <vector>
 
 namespace pr = pronto::raster;
 
@@ -62,6 +76,517 @@ bool test_moving_window()
 
 }
 
+bool test_moving_window_parallel()
+{
+  auto a = pr::memory_raster<int>(97, 31);
+  for (int i = 0; auto && v : a)
+  {
+    v = (i++ * 7) % 11;
+  }
+  // the bands must start with the same column subtotals as the sequential
+  // iteration at the same row.
+  auto circle_view = pr::moving_window_indicator(a, pr::circle(4.5), pr::mean_generator<int>{});
+  auto circle_par = pr::moving_window_indicator(std::execution::par, a, pr::circle(4.5), pr::mean_generator<int>{});
+  auto square_view = pr::moving_window_indicator(a, pr::square(3), pr::mean_generator<int>{});
+  auto square_par = pr::moving_window_indicator(std::execution::par, a, pr::square(3), pr::mean_generator<int>{});
+  auto square_seq = pr::moving_window_indicator(std::execution::seq, a, pr::square(3), pr::mean_generator<int>{});
+
+  auto values = [](const auto& raster) {
+    std::vector<std::optional<double> > v;
+    for (auto&& i : raster) {
+      v.push_back(i);
+    }
+    return v;
+  };
+  return values(circle_view) == values(circle_par)
+    && values(square_view) == values(square_par)
+    && values(square_view) == values(square_seq);
+}
+
+bool test_moving_window_linear_accumulator()
+{
+  // mean is a linear accumulator, its column subtotals are kept as arrays
+  const int rows = 23;
+  const int cols = 17;
+  const int radius = 3;
+  auto a = pr::memory_raster<std::optional<int> >(rows, cols);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 13 == 5) v = std::nullopt;
+    else v = (i * 7) % 11;
+    ++i;
+  }
+  static_assert(pr::LinearAccumulator<pr::mean<int>, std::optional<int> >);
+
+  auto w = pr::moving_window_indicator(a, pr::square(radius), pr::mean_generator<int>{});
+  std::vector<std::optional<double> > expected;
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      double sum = 0;
+      int n = 0;
+      for (int i = std::max(0, r - radius); i < std::min(rows, r + radius + 1); ++i) {
+        for (int j = std::max(0, c - radius); j < std::min(cols, c + radius + 1); ++j) {
+          const std::optional<int> v = *(a.begin() + i * cols + j);
+          if (v) {
+            sum += *v;
+            ++n;
+          }
+        }
+      }
+      expected.push_back(n > 0 ? std::optional<double>(sum / n) : std::nullopt);
+    }
+  }
+  bool ok = true;
+  auto e = expected.begin();
+  for (auto&& v : w) {
+    ok = ok && v.has_value() == e->has_value() && (!v || std::abs(*v - **e) < 1e-9);
+    ++e;
+  }
+  return ok;
+}
+
+bool test_moving_window_summed_area()
+{
+  auto a = pr::memory_raster<std::optional<int> >(41, 29);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 7 == 3) v = std::nullopt;
+    else v = (i * 5) % 13;
+    ++i;
+  }
+  // one table for all radii, the sums of integers are exact
+  auto table = pr::summed_area_table(a);
+  bool ok = true;
+  for (int radius : {0, 1, 4, 25}) {
+    auto sliding = pr::moving_window_indicator(a, pr::square(radius), pr::mean_generator<int>{});
+    auto summed = pr::moving_window_indicator(table, pr::square(radius), pr::mean_generator<int>{});
+    static_assert(std::ranges::random_access_range<decltype(summed)>);
+    auto i = summed.begin();
+    for (auto&& v : sliding) {
+      ok = ok && v == *i;
+      ++i;
+    }
+    auto sub = summed.sub_raster(10, 5, 3, 4);
+    auto sliding_sub = sliding.sub_raster(10, 5, 3, 4);
+    auto j = sub.begin();
+    for (auto&& v : sliding_sub) {
+      ok = ok && v == *j;
+      ++j;
+    }
+  }
+  auto counts = pr::moving_window_indicator(table, pr::square(1), pr::count_generator<int>{});
+  ok = ok && *counts.begin() == 4 && *(counts.begin() + 30) == 7;
+
+  // the policy overload streams the table in bands of rows
+  for (int radius : {0, 2, 25}) {
+    auto sliding = pr::moving_window_indicator(a, pr::square(radius), pr::mean_generator<int>{});
+    auto streamed = pr::moving_window_indicator(std::execution::par, a, pr::square(radius), pr::mean_generator<int>{});
+    auto i = streamed.begin();
+    for (auto&& v : sliding) {
+      ok = ok && v == *i;
+      ++i;
+    }
+  }
+
+  // the differences of the large sums keep the precision of the samples
+  auto b = pr::memory_raster<double>(300, 300);
+  for (auto&& v : b) {
+    v = 1e9 + 0.1;
+  }
+  auto large = pr::summed_area_table(b);
+  auto large_means = pr::moving_window_indicator(large, pr::square(1), pr::mean_generator<double>{});
+  auto streamed_means = pr::moving_window_indicator(std::execution::seq, b, pr::square(1), pr::mean_generator<double>{});
+  auto m = streamed_means.begin();
+  for (auto&& v : large_means) {
+    ok = ok && std::abs(*v - (1e9 + 0.1)) < 1e-6 && std::abs(*(*m) - (1e9 + 0.1)) < 1e-6;
+    ++m;
+  }
+  return ok;
+}
+
+bool test_moving_window_multi_radius()
+{
+  auto a = pr::memory_raster<std::optional<int> >(23, 19);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 7 == 3) v = std::nullopt;
+    else v = (i * 5) % 13;
+    ++i;
+  }
+  // not in ascending order, the bands follow the order of the windows
+  std::vector<pr::circle> windows{ pr::circle(3.5), pr::circle(1), pr::circle(2.2) };
+  auto multi = pr::moving_window_indicator(a, windows, pr::mean_generator<int>{});
+  bool ok = multi.rows() == 23 && multi.cols() == 19;
+  for (int k = 0; k < 3; ++k) {
+    auto single = pr::moving_window_indicator(a, windows[k], pr::mean_generator<int>{});
+    auto i = multi.begin();
+    for (auto&& v : single) {
+      std::optional<double> m = (*i)[k];
+      ok = ok && m == v;
+      ++i;
+    }
+  }
+
+  // at least one window is needed
+  bool threw = false;
+  try {
+    pr::moving_window_indicator(a, std::vector<pr::circle>{}, pr::mean_generator<int>{});
+  }
+  catch (const pr::moving_window_indicator_without_windows&) {
+    threw = true;
+  }
+  return ok && threw;
+}
+
+bool test_moving_window_fused()
+{
+  auto a = pr::memory_raster<std::optional<int> >(17, 13);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 5 == 2) v = std::nullopt;
+    else v = (i * 7) % 4;
+    ++i;
+  }
+  auto fused = pr::fuse(pr::shannon_diversity_generator{}
+    , pr::count_generator<int>{}, pr::mean_generator<int>{});
+
+  // each component to its own band
+  auto diversity = pr::memory_raster<double>(17, 13);
+  auto counts = pr::memory_raster<int>(17, 13);
+  auto means = pr::memory_raster<std::optional<double> >(17, 13);
+  auto bands = pr::raster_tuple(diversity, counts, means);
+  pr::assign(bands, pr::moving_window_indicator(a, pr::circle(2.5), fused));
+
+  bool ok = true;
+  auto d = diversity.begin();
+  for (auto&& v : pr::moving_window_indicator(a, pr::circle(2.5), pr::shannon_diversity_generator{})) {
+    ok = ok && *d == v;
+    ++d;
+  }
+  auto c = counts.begin();
+  for (auto&& v : pr::moving_window_indicator(a, pr::circle(2.5), pr::count_generator<int>{})) {
+    ok = ok && *c == v;
+    ++c;
+  }
+  auto m = means.begin();
+  for (auto&& v : pr::moving_window_indicator(a, pr::circle(2.5), pr::mean_generator<int>{})) {
+    ok = ok && *m == v;
+    ++m;
+  }
+
+  // square windows also combine the subtotals
+  auto tuples = pr::moving_window_indicator(a, pr::square(2), fused);
+  auto t = tuples.begin();
+  for (auto&& v : pr::moving_window_indicator(a, pr::square(2), pr::mean_generator<int>{})) {
+    ok = ok && std::get<2>(*t) == v;
+    ++t;
+  }
+  return ok;
+}
+
+bool test_moving_window_convolution()
+{
+  auto a = pr::memory_raster<std::optional<int> >(53, 71);
+  for (int i = 0; auto && v : a)
+  {
+    const int row = i / 71;
+    const int col = i % 71;
+    if (i % 7 == 3 || (row > 20 && row < 40 && col < 30)) v = std::nullopt;
+    else v = (i * 5) % 13;
+    ++i;
+  }
+  auto same = [](const auto& expected, const auto& convolved) {
+    bool ok = true;
+    auto i = convolved.begin();
+    for (auto&& v : expected) {
+      std::optional<double> c = *i;
+      ok = ok && v.has_value() == c.has_value() && (!v || std::abs(*v - *c) < 1e-9);
+      ++i;
+    }
+    return ok;
+  };
+
+  // exponential decay, by FFT
+  auto decay = pr::weighted_window(10.5, [](double d) { return std::exp(-0.2 * d); });
+  bool ok = same(pr::moving_window_indicator(a, decay, pr::mean_generator<int>{})
+    , pr::moving_window_indicator(std::execution::par, a, decay, pr::mean_generator<int>{}));
+
+  // Gaussian, separable
+  auto gauss = pr::make_separable_weighted_window(6, [](double d) { return std::exp(-d * d / 8); });
+  ok = ok && same(pr::moving_window_indicator(a, gauss, pr::mean_generator<int>{})
+    , pr::moving_window_indicator(std::execution::seq, a, gauss, pr::mean_generator<int>{}));
+
+  // the FFT replaces the input by groups of bands of tiles, these must 
+  // still read the input above them
+  auto tall = pr::memory_raster<std::optional<int> >(250, 17);
+  for (int i = 0; auto && v : tall)
+  {
+    if (i % 5 == 2) v = std::nullopt;
+    else v = (i * 3) % 11;
+    ++i;
+  }
+  ok = ok && same(pr::moving_window_indicator(tall, decay, pr::mean_generator<int>{})
+    , pr::moving_window_indicator(std::execution::seq, tall, decay, pr::mean_generator<int>{}));
+  ok = ok && same(pr::moving_window_indicator(tall, decay, pr::mean_generator<int>{})
+    , pr::moving_window_indicator(std::execution::par, tall, decay, pr::mean_generator<int>{}));
+
+  // integral counts are rounded, not truncated
+  auto disk = pr::weighted_window(10.5, [](double) { return 1.0; });
+  auto counts = pr::moving_window_indicator(a, disk, pr::count_generator<std::optional<int>, int>{});
+  auto fft_counts = pr::moving_window_indicator(std::execution::par, a, disk
+    , pr::count_generator<std::optional<int>, int>{});
+  ok = ok && std::equal(counts.begin(), counts.end(), fft_counts.begin()
+    , [](int x, int y) { return x == y; });
+  return ok;
+}
+
+bool test_moving_window_recursive_filters()
+{
+  auto a = pr::memory_raster<std::optional<int> >(53, 71);
+  for (int i = 0; auto && v : a)
+  {
+    const int row = i / 71;
+    const int col = i % 71;
+    if (i % 7 == 3 || (row > 20 && row < 40 && col < 30)) v = std::nullopt;
+    else v = (i * 5) % 13;
+    ++i;
+  }
+
+  // exponential decay with the city-block distance is exact
+  const double rate = 0.5;
+  auto decay = pr::make_separable_weighted_window(60, [&](double d) { return std::exp(-rate * d); });
+  auto exact = pr::moving_window_indicator(std::execution::seq, a, decay, pr::mean_generator<int>{});
+  auto recursive = pr::moving_window_indicator(std::execution::par, a
+    , pr::exponential_window(rate), pr::mean_generator<int>{});
+  bool ok = true;
+  auto i = recursive.begin();
+  for (auto&& v : exact) {
+    std::optional<double> r = *i;
+    ok = ok && v.has_value() == r.has_value() && (!v || std::abs(*v - *r) < 1e-9);
+    ++i;
+  }
+
+  // the Gaussian is approximated, windows with little data have no data
+  const double sigma = 8;
+  auto gauss = pr::make_separable_weighted_window(60, [&](double d) { return std::exp(-d * d / (2 * sigma * sigma)); });
+  exact = pr::moving_window_indicator(std::execution::seq, a, gauss, pr::mean_generator<int>{});
+  recursive = pr::moving_window_indicator(std::execution::par, a
+    , pr::gaussian_window(sigma), pr::mean_generator<int>{});
+  auto j = recursive.begin();
+  auto k = a.begin();
+  for (auto&& v : exact) {
+    std::optional<double> r = *j;
+    ok = ok && (!(*k).has_value() || r.has_value());
+    ok = ok && (!r || std::abs(*v - *r) < 0.01);
+    ++j;
+    ++k;
+  }
+
+  // a single cell with data is not dropped by the tolerance
+  auto single = pr::memory_raster<std::optional<int> >(61, 61);
+  for (auto&& v : single) {
+    v = std::nullopt;
+  }
+  *(single.begin() + 30 * 61 + 30) = 7;
+  auto single_gauss = pr::moving_window_indicator(std::execution::par, single
+    , pr::gaussian_window(10), pr::mean_generator<int>{});
+  const std::optional<double> center = *(single_gauss.begin() + 30 * 61 + 30);
+  const std::optional<double> corner = *single_gauss.begin();
+  ok = ok && center && std::abs(*center - 7) < 1e-9 && !corner;
+
+  bool thrown = false;
+  try {
+    pr::moving_window_indicator(std::execution::par, single
+      , pr::gaussian_window(0.3), pr::mean_generator<int>{});
+  }
+  catch (const pr::gaussian_window_sigma_too_small&) {
+    thrown = true;
+  }
+  return ok && thrown;
+}
+
+bool test_moving_window_dense_most_common_class()
+{
+  const int rows = 31;
+  const int cols = 23;
+  const int num_classes = 7;
+  auto a = pr::memory_raster<std::optional<int> >(rows, cols);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 11 == 3) v = std::nullopt;
+    else v = (i * i + i / 5) % num_classes;
+    ++i;
+  }
+
+  // the count of the most common class in the square around each cell
+  auto max_count = [&](int row, int col, int radius) {
+    std::vector<int> counts(num_classes, 0);
+    for (int r = std::max(0, row - radius); r <= std::min(rows - 1, row + radius); ++r) {
+      for (int c = std::max(0, col - radius); c <= std::min(cols - 1, col + radius); ++c) {
+        const std::optional<int> v = *(a.begin() + r * cols + c);
+        if (v) ++counts[*v];
+      }
+    }
+    return *std::max_element(counts.begin(), counts.end());
+  };
+
+  auto counts_of = [&](int row, int col, int radius, int cls) {
+    int count = 0;
+    for (int r = std::max(0, row - radius); r <= std::min(rows - 1, row + radius); ++r) {
+      for (int c = std::max(0, col - radius); c <= std::min(cols - 1, col + radius); ++c) {
+        const std::optional<int> v = *(a.begin() + r * cols + c);
+        count += v == cls;
+      }
+    }
+    return count;
+  };
+
+  bool ok = true;
+  for (int radius : {1, 3}) {
+    auto dense = pr::moving_window_indicator(a, pr::square(radius)
+      , pr::dense_most_common_class_generator<int>(num_classes));
+    auto sparse = pr::moving_window_indicator(a, pr::square(radius)
+      , pr::most_common_class_generator<int>{});
+    auto j = sparse.begin();
+    for (int i = 0; auto && v : dense) {
+      const std::optional<int> s = *j;
+      // ties may be broken differently
+      ok = ok && v && s && counts_of(i / cols, i % cols, radius, *v) == max_count(i / cols, i % cols, radius)
+        && counts_of(i / cols, i % cols, radius, *s) == max_count(i / cols, i % cols, radius);
+      ++i;
+      ++j;
+    }
+  }
+
+  // in a circle of radius 1.5 all 3 x 3 cells are included
+  auto circle = pr::moving_window_indicator(a, pr::circle(1.5)
+    , pr::dense_most_common_class_generator<int>(num_classes));
+  for (int i = 0; auto && v : circle) {
+    ok = ok && v && counts_of(i / cols, i % cols, 1, *v) == max_count(i / cols, i % cols, 1);
+    ++i;
+  }
+
+  // classes must be less than num_classes
+  bool thrown = false;
+  try {
+    auto too_few = pr::moving_window_indicator(a, pr::square(1)
+      , pr::dense_most_common_class_generator<int>(num_classes - 1));
+    for (auto&& v : too_few) {
+    }
+  }
+  catch (const pr::dense_indicator_class_out_of_range&) {
+    thrown = true;
+  }
+  return ok && thrown;
+}
+
+bool test_moving_window_dense_interspersion()
+{
+  auto a = pr::memory_raster<int>(41, 37);
+  for (int i = 0; auto && v : a)
+  {
+    v = (i * i + i / 7) % 6;
+    ++i;
+  }
+  auto same = [](const auto& expected, const auto& dense) {
+    bool ok = true;
+    auto i = dense.begin();
+    for (auto&& v : expected) {
+      const std::optional<double> d = *i;
+      ok = ok && v.has_value() == d.has_value() && (!v || std::abs(*v - *d) < 1e-9);
+      ++i;
+    }
+    return ok;
+  };
+  bool ok = same(pr::moving_window_indicator(a, pr::edge_circle(2.5), pr::interspersion_generator<int>{})
+    , pr::moving_window_indicator(a, pr::edge_circle(2.5), pr::dense_interspersion_generator<int>(6)));
+  ok = ok && same(pr::moving_window_indicator(a, pr::edge_square(2), pr::interspersion_generator<int>{})
+    , pr::moving_window_indicator(a, pr::edge_square(2), pr::dense_interspersion_generator<int>(6)));
+
+  // classes must be less than num_classes
+  bool thrown = false;
+  try {
+    auto too_few = pr::moving_window_indicator(a, pr::edge_square(2)
+      , pr::dense_interspersion_generator<int>(5));
+    for (auto&& v : too_few) {
+    }
+  }
+  catch (const pr::dense_indicator_class_out_of_range&) {
+    thrown = true;
+  }
+  ok = ok && thrown;
+
+  // edge windows on a memory_raster give the same as on a GDAL raster
+  auto b = pr::create_temp<int>(41, 37);
+  pr::assign(b, a);
+  ok = ok && same(pr::moving_window_indicator(b, pr::edge_square(1), pr::edge_density_generator<int>{})
+    , pr::moving_window_indicator(a, pr::edge_square(1), pr::edge_density_generator<int>{}));
+  ok = ok && same(pr::moving_window_indicator(b, pr::edge_circle(2.5), pr::edge_density_generator<int>{})
+    , pr::moving_window_indicator(a, pr::edge_circle(2.5), pr::edge_density_generator<int>{}));
+  return ok;
+}
+
+bool test_moving_window_shannon_diversity()
+{
+  const int rows = 29;
+  const int cols = 31;
+  const int num_classes = 9;
+  auto a = pr::memory_raster<std::optional<int> >(rows, cols);
+  for (int i = 0; auto && v : a)
+  {
+    if (i % 13 == 5) v = std::nullopt;
+    else v = (i * i + i / 3) % num_classes;
+    ++i;
+  }
+
+  auto entropy = [&](int row, int col, int radius) {
+    std::vector<double> counts(num_classes, 0);
+    double total = 0;
+    for (int r = std::max(0, row - radius); r <= std::min(rows - 1, row + radius); ++r) {
+      for (int c = std::max(0, col - radius); c <= std::min(cols - 1, col + radius); ++c) {
+        const std::optional<int> v = *(a.begin() + r * cols + c);
+        if (v) {
+          ++counts[*v];
+          ++total;
+        }
+      }
+    }
+    double h = 0;
+    for (auto c : counts) {
+      if (c > 0) h -= c / total * std::log(c / total);
+    }
+    return h;
+  };
+
+  bool ok = true;
+  auto square = pr::moving_window_indicator(a, pr::square(2)
+    , pr::shannon_diversity_generator(num_classes));
+  for (int i = 0; auto && v : square) {
+    ok = ok && std::abs(v - entropy(i / cols, i % cols, 2)) < 1e-9;
+    ++i;
+  }
+
+  // in a circle of radius 1.5 all 3 x 3 cells are included, the classes
+  // are not preallocated
+  auto circle = pr::moving_window_indicator(a, pr::circle(1.5)
+    , pr::shannon_diversity_generator{});
+  for (int i = 0; auto && v : circle) {
+    ok = ok && std::abs(v - entropy(i / cols, i % cols, 1)) < 1e-9;
+    ++i;
+  }
+  return ok;
+}
+
 TEST(RasterTest, MovingWindowIndicator) {
   EXPECT_TRUE(test_moving_window());
+  EXPECT_TRUE(test_moving_window_parallel());
+  EXPECT_TRUE(test_moving_window_linear_accumulator());
+  EXPECT_TRUE(test_moving_window_summed_area());
+  EXPECT_TRUE(test_moving_window_multi_radius());
+  EXPECT_TRUE(test_moving_window_fused());
+  EXPECT_TRUE(test_moving_window_convolution());
+  EXPECT_TRUE(test_moving_window_recursive_filters());
+  EXPECT_TRUE(test_moving_window_dense_most_common_class());
+  EXPECT_TRUE(test_moving_window_dense_interspersion());
+  EXPECT_TRUE(test_moving_window_shannon_diversity());
 }
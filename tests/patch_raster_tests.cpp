@@ -0,0 +1,274 @@
+//
+//=======================================================================
+// Copyright 2022
+// Author: Alex Hagen-Zanker
+// University of Surrey
+//
+// Distributed under the MIT Licence (http://opensource.org/licenses/MIT)
+//=======================================================================
+//
+#define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
+#include <gtest/gtest.h>
+
+#include <pronto/raster/memory_raster.h>
+#include <pronto/raster/patch_raster_transform.h>
+#include <pronto/raster/transform_raster_view.h>
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace pr = pronto::raster;
+
+// Flood fill, patches are indexed in the order of their first cell
+template<pr::contiguity Contiguity>
+std::vector<pr::patch_info> flood_fill(const std::vector<int>& values
+  , int rows, int cols)
+{
+  std::vector<int> index(values.size(), -1);
+  std::vector<pr::patch_info> patches;
+  for (int start = 0; start < rows * cols; ++start) {
+    if (index[start] != -1) continue;
+    const int id = static_cast<int>(patches.size());
+    pr::patch_info patch{ 0, 0, values[start] };
+    std::vector<int> stack{ start };
+    index[start] = id;
+    while (!stack.empty()) {
+      const int i = stack.back();
+      stack.pop_back();
+      ++patch.m_area;
+      const int r = i / cols;
+      const int c = i % cols;
+      for (int dr = -1; dr <= 1; ++dr) {
+        for (int dc = -1; dc <= 1; ++dc) {
+          const bool rook = (dr == 0) != (dc == 0);
+          const bool queen = dr != 0 && dc != 0;
+          const int nr = r + dr;
+          const int nc = c + dc;
+          if (nr < 0 || nr >= rows || nc < 0 || nc >= cols) continue;
+          const int j = nr * cols + nc;
+          if (rook && values[j] != values[i]) ++patch.m_perimeter;
+          if ((rook || (queen && Contiguity == pr::contiguity::queen))
+            && values[j] == values[i] && index[j] == -1) {
+            index[j] = id;
+            stack.push_back(j);
+          }
+        }
+      }
+    }
+    patches.push_back(patch);
+  }
+
+  // Return the patch of each cell
+  std::vector<pr::patch_info> out;
+  for (auto i : index) {
+    out.push_back(patches[i]);
+  }
+  return out;
+}
+
+template<class PatchRaster>
+bool equal_patches(const PatchRaster& patches
+  , const std::vector<pr::patch_info>& expected)
+{
+  int i = 0;
+  for (auto&& p : patches) {
+    const std::optional<pr::patch_info> q = p;
+    const pr::patch_info& e = expected[i++];
+    if (!q || q->m_area != e.m_area || q->m_perimeter != e.m_perimeter
+      || q->m_category != e.m_category) {
+      return false;
+    }
+  }
+  return i == static_cast<int>(expected.size());
+}
+
+bool test_patch_raster()
+{
+  const int rows = 37;
+  const int cols = 23;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    // Spirals and stripes that give patches that are U-shaped, diagonally
+    // connected and that meet the edges
+    v = ((i * 7 + (i / cols) * (i / cols)) / 5) % 3;
+    values.push_back(v);
+    ++i;
+  }
+
+  auto queen = pr::patch_raster(a, pr::queen_contiguity{});
+  auto rook = pr::patch_raster(a, pr::rook_contiguity{});
+  bool ok = equal_patches(queen
+    , flood_fill<pr::contiguity::queen>(values, rows, cols));
+  ok = ok && equal_patches(rook
+    , flood_fill<pr::contiguity::rook>(values, rows, cols));
+
+  // A sub-raster shares the labelling of the full raster
+  auto expected = flood_fill<pr::contiguity::rook>(values, rows, cols);
+  std::vector<pr::patch_info> sub_expected;
+  for (int r = 3; r < 3 + 10; ++r) {
+    for (int c = 4; c < 4 + 12; ++c) {
+      sub_expected.push_back(expected[r * cols + c]);
+    }
+  }
+  ok = ok && equal_patches(rook.sub_raster(3, 4, 10, 12), sub_expected);
+  return ok;
+}
+
+bool test_patch_raster_parallel()
+{
+  const int rows = 41;
+  const int cols = 19;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    // Long vertical stripes and diagonals that cross many bands
+    const int r = i / cols;
+    const int c = i % cols;
+    v = c % 4 == 1 ? 1 : ((r + c) / 3 + r * r / 7) % 3;
+    values.push_back(v);
+    ++i;
+  }
+
+  // Small tiles, so patches cross many seams
+  bool ok = true;
+  for (int num_threads : { 1, 3, 8 }) {
+    auto queen = pr::patch_raster(a, pr::queen_contiguity{}
+      , pr::memory_raster_allocator{}, num_threads, 4);
+    auto rook = pr::patch_raster(a, pr::rook_contiguity{}
+      , pr::memory_raster_allocator{}, num_threads, 7);
+    ok = ok && equal_patches(queen
+      , flood_fill<pr::contiguity::queen>(values, rows, cols));
+    ok = ok && equal_patches(rook
+      , flood_fill<pr::contiguity::rook>(values, rows, cols));
+  }
+  return ok;
+}
+
+bool test_patch_raster_lazy()
+{
+  const int rows = 40;
+  const int cols = 40;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    // Blocks of 5 x 5 cells, and a long snake of 2s that crosses most tiles
+    const int r = i / cols;
+    const int c = i % cols;
+    v = (r % 8 == 3 && c > 1) || (c == 38 && r < 36) ? 2 : (r / 5 + c / 5) % 2;
+    values.push_back(v);
+    ++i;
+  }
+  auto expected = flood_fill<pr::contiguity::rook>(values, rows, cols);
+
+  // Sub-rasters are labelled before the full raster, on tiles of 8 x 8
+  auto patches = pr::patch_raster(a, pr::rook_contiguity{}
+    , pr::memory_raster_allocator{}, 2, 8);
+  bool ok = true;
+  for (auto [first_row, first_col] : { std::pair{ 12, 13 }, std::pair{ 3, 0 }
+    , std::pair{ 30, 29 } }) {
+    std::vector<pr::patch_info> sub_expected;
+    for (int r = first_row; r < first_row + 6; ++r) {
+      for (int c = first_col; c < first_col + 9; ++c) {
+        sub_expected.push_back(expected[r * cols + c]);
+      }
+    }
+    ok = ok && equal_patches(patches.sub_raster(first_row, first_col, 6, 9)
+      , sub_expected);
+  }
+  ok = ok && equal_patches(patches, expected);
+
+  // Iterators from the end are labelled too
+  auto fresh = pr::patch_raster(a, pr::rook_contiguity{}
+    , pr::memory_raster_allocator{}, 2, 8);
+  const std::optional<pr::patch_info> last = *(fresh.sub_raster(30, 29, 6, 9).end() - 1);
+  const pr::patch_info& last_expected = expected[35 * cols + 37];
+  ok = ok && last && last->m_area == last_expected.m_area
+    && last->m_perimeter == last_expected.m_perimeter;
+  return ok;
+}
+
+bool test_patch_raster_read_failure()
+{
+  const int rows = 40;
+  const int cols = 40;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    const int r = i / cols;
+    const int c = i % cols;
+    v = (r % 8 == 3 && c > 1) || (c == 38 && r < 36) ? 2 : (r / 5 + c / 5) % 2;
+    values.push_back(v);
+    ++i;
+  }
+  auto expected = flood_fill<pr::contiguity::rook>(values, rows, cols);
+
+  // Reading fails after the four tiles of the sub-raster, while the tiles
+  // around them are labelled to complete the snake of 2s
+  int reads_left = 4 * 8 * 8;
+  auto failing = pr::transform([&reads_left](int v) {
+    if (reads_left-- == 0) throw std::runtime_error("reading failed");
+    return v; }, a);
+  auto patches = pr::patch_raster(failing, pr::rook_contiguity{}
+    , pr::memory_raster_allocator{}, 1, 8);
+  bool thrown = false;
+  try {
+    patches.sub_raster(3, 0, 6, 9).begin();
+  }
+  catch (const std::runtime_error&) {
+    thrown = true;
+  }
+
+  // The patches of the sub-raster are still completed by the next call
+  reads_left = -1;
+  std::vector<pr::patch_info> sub_expected;
+  for (int r = 3; r < 9; ++r) {
+    for (int c = 0; c < 9; ++c) {
+      sub_expected.push_back(expected[r * cols + c]);
+    }
+  }
+  return thrown && equal_patches(patches.sub_raster(3, 0, 6, 9), sub_expected);
+}
+
+bool test_patch_raster_label_type()
+{
+  const int rows = 300;
+  const int cols = 290;
+  pr::memory_raster<int> a(rows, cols);
+  std::vector<int> values;
+  for (int i = 0; auto && v : a)
+  {
+    // Many small patches and a few that span the raster
+    const int r = i / cols;
+    const int c = i % cols;
+    v = r % 50 == 7 || c % 60 == 11 ? 2 : ((r * r + c * 3) / 11) % 2;
+    values.push_back(v);
+    ++i;
+  }
+
+  // Tiles of 1000 x 1000 cells do not fit 16-bit labels and are made smaller
+  auto queen = pr::patch_raster<std::uint16_t>(a, pr::queen_contiguity{}
+    , pr::memory_raster_allocator{}, 2, 1000);
+  auto rook = pr::patch_raster<std::uint16_t>(a, pr::rook_contiguity{}
+    , pr::memory_raster_allocator{}, 2, 1000);
+  bool ok = equal_patches(queen
+    , flood_fill<pr::contiguity::queen>(values, rows, cols));
+  ok = ok && equal_patches(rook
+    , flood_fill<pr::contiguity::rook>(values, rows, cols));
+  return ok;
+}
+
+TEST(RasterTest, PatchRaster) {
+  EXPECT_TRUE(test_patch_raster());
+  EXPECT_TRUE(test_patch_raster_parallel());
+  EXPECT_TRUE(test_patch_raster_lazy());
+  EXPECT_TRUE(test_patch_raster_read_failure());
+  EXPECT_TRUE(test_patch_raster_label_type());
+}
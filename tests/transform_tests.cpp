@@ -1,9 +1,14 @@
 #define _SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING
 #include <gtest/gtest.h>
 
+#include <pronto/raster/assign.h>
+#include <pronto/raster/block_layout.h>
 #include <pronto/raster/io.h>
+#include <pronto/raster/memory_raster.h>
 #include <pronto/raster/transform_raster_view.h>
 
+#include <execution>
+#include <functional>
 #include <vector>
 
 namespace pr = pronto::raster;
@@ -338,6 +343,105 @@ bool transform_sub_raster_random_access()
 
 }
 
+bool transform_assign_by_stretches()
+{
+  int rows = 6;
+  int cols = 3;
+  auto a = pr::create_temp<int>(rows, cols);
+  int ones = 0;
+  for (auto&& i : a) {
+    ones += 1;
+    i = ones;
+  }
+  auto b = pr::create_temp<int>(rows, cols);
+  int hundreds = 0;
+  for (auto&& i : b) {
+    hundreds += 100;
+    i = hundreds;
+  }
+  auto lambda = [](int a, int b) {return a + b; };
+  auto c = pr::transform(lambda, a, b).sub_raster(2, 1, 3, 2);
+  static_assert(pr::StretchRasterConcept<decltype(c)>);
+
+  auto d = pr::create_temp<double>(3, 2, GDT_Int32); // converted on access
+  pr::assign(d, c);
+  std::vector<double> check;
+  for (auto&& i : d) {
+    check.push_back(i);
+  }
+  return check == std::vector<double>{ 808, 909,  1111, 1212, 1414, 1515};
+}
+
+bool transform_assign_parallel()
+{
+  // larger than a block, such that there are multiple tiles
+  int rows = 600;
+  int cols = 520;
+  auto a = pr::create_temp<int>(rows, cols);
+  int ones = 0;
+  for (auto&& i : a) {
+    i = ones++;
+  }
+  auto b = pr::create_temp<int>(rows, cols);
+  auto lambda = [](int a) {return 2 * a; };
+  pr::assign(std::execution::par, b, pr::transform(lambda, a));
+
+  // also for a sub_raster that is not aligned to the blocks
+  auto c = pr::create_temp<int>(rows, cols);
+  auto sub_c = c.sub_raster(10, 20, rows - 10, cols - 20);
+  pr::assign_blocked_parallel(sub_c, a.sub_raster(0, 0, rows - 10, cols - 20), 3);
+
+  int check = 0;
+  for (auto&& i : b) {
+    if (i != 2 * check++) return false;
+  }
+  int index = 0;
+  for (auto&& i : sub_c) {
+    int row = index / (cols - 20);
+    int col = index % (cols - 20);
+    if (i != row * cols + col) return false;
+    ++index;
+  }
+  return index == (rows - 10) * (cols - 20);
+}
+
+bool transform_assign_tile_major()
+{
+  int rows = 600;
+  int cols = 520;
+  auto a = pr::create_temp<int>(rows, cols);
+  int ones = 0;
+  for (auto&& i : a) {
+    i = ones++;
+  }
+  auto b = pr::create_temp<int>(rows, cols);
+  for (auto&& i : b) {
+    i = 1;
+  }
+  // tiles follow the blocks of the inputs, also when these are offset
+  auto in = pr::transform(std::plus<int>{}, a.sub_raster(30, 40, 500, 400)
+    , b.sub_raster(30, 40, 500, 400));
+  auto layout = pr::get_tile_layout(in);
+  if (layout.rows != 256 || layout.cols != 256 
+    || layout.row_offset != 30 || layout.col_offset != 40) return false;
+
+  auto c = pr::memory_raster<int>(500, 400);
+  pr::assign(c, in, pr::traversal::tile_major);
+  int index = 0;
+  for (auto&& i : c) {
+    int row = 30 + index / 400;
+    int col = 40 + index % 400;
+    if (i != row * cols + col + 1) return false;
+    ++index;
+  }
+
+  int tiles = 0;
+  pr::for_each_tile(in, [&](const pr::tile& t, auto sub) { 
+    ++tiles;
+    });
+  return tiles == 6 && index == 500 * 400;
+}
+
 TEST(RasterTest, Transform) {
 	EXPECT_TRUE(transform_with_overloaded_function_object());
   EXPECT_TRUE(transform_with_uncopyable_function_object());
@@ -349,4 +453,7 @@ TEST(RasterTest, Transform) {
   EXPECT_TRUE(transform_empty());
   EXPECT_TRUE(transform_sub_raster());
   EXPECT_TRUE(transform_sub_raster_random_access());
+  EXPECT_TRUE(transform_assign_by_stretches());
+  EXPECT_TRUE(transform_assign_parallel());
+  EXPECT_TRUE(transform_assign_tile_major());
 }